@@ -0,0 +1,37 @@
+/* File: allocations.cc
+ * --------------------
+ * The counting operator new and delete. The counts are plain thread
+ * locals, so counting costs two increments and no locking. new[] and
+ * delete[] go through these by default.
+ */
+
+#include "allocations.h"
+#include <stdlib.h>
+#include <new>
+
+static thread_local AllocationCount allocations;
+
+AllocationCount ThreadAllocations()
+{
+    return allocations;
+}
+
+void *operator new(size_t size)
+{
+    allocations.count++;
+    allocations.bytes += size;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t size) noexcept
+{
+    free(p);
+}
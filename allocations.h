@@ -0,0 +1,26 @@
+/* File: allocations.h
+ * -------------------
+ * dcc replaces the global operator new and delete with ones that count,
+ * for each thread, how many allocations have been made and how many
+ * bytes they asked for. The phases of a compilation (see compilation.h)
+ * read the counts before and after they run to report what each one
+ * allocated. Memory taken with malloc() or strdup() directly is not
+ * counted.
+ */
+
+#ifndef _H_allocations
+#define _H_allocations
+
+struct AllocationCount {
+    unsigned long count;  // calls to operator new
+    unsigned long bytes;  // total size asked for
+};
+
+/* Function: ThreadAllocations()
+ * Usage: AllocationCount before = ThreadAllocations();
+ * ----------------------------------------------------
+ * Returns the allocations made on this thread since it started.
+ */
+AllocationCount ThreadAllocations();
+
+#endif
@@ -0,0 +1,28 @@
+/* File: annotations.cc
+ * --------------------
+ * Implementation of the Annotations class.
+ */
+
+#include "annotations.h"
+#include <stdlib.h>
+
+thread_local Annotations *Annotations::current;
+const char Annotations::unresolved = 0;
+
+void Annotations::Release()
+{
+    free(types);
+    free(decls);
+    types = NULL;
+    decls = NULL;
+    count = capacity = 0;
+}
+
+void Annotations::Grow()
+{
+    capacity = capacity ? 2 * capacity : 1024;
+    types = (Type **)realloc(types, capacity * sizeof(Type *));
+    decls = (const Decl **)realloc(decls, capacity * sizeof(const Decl *));
+    if (types == NULL || decls == NULL)
+        Failure("Out of memory for the annotations of %u expressions", count);
+}
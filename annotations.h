@@ -0,0 +1,88 @@
+/* File: annotations.h
+ * -------------------
+ * This file declares Annotations, the tables of what the checks find
+ * out about a compilation's expressions: the type of each, and for a
+ * FieldAccess, Call or This, the declaration it names. They are kept apart
+ * from the tree, one array for each, indexed by the id each expression
+ * is given when it is made: ids are dense and in the order the parser
+ * builds the expressions, so the tables are as long as the number of
+ * expressions and a lookup is an array load. They grow as the parser
+ * makes expressions, doubling with realloc(), which can move a large
+ * table's pages rather than copy them.
+ *
+ * Nothing in the tree is written when an expression is annotated, so
+ * the tree can be read while the tables are filled in, and the tables
+ * can be thrown away with Release() while the tree is kept.
+ */
+
+#ifndef _H_annotations
+#define _H_annotations
+
+#include <stdint.h>
+#include "utility.h"  // for Assert()
+
+class Type;
+class Decl;
+
+class Annotations
+{
+  public:
+    Annotations() : types(NULL), decls(NULL), count(0), capacity(0) {}
+    ~Annotations() { Release(); }
+    Annotations(const Annotations &) = delete;
+    Annotations &operator=(const Annotations &) = delete;
+
+    // Returns the id of a new expression, with no type or declaration.
+    uint32_t NewExpr()
+    {
+        if (count == capacity)
+            Grow();
+        types[count] = NULL;
+        decls[count] = NULL;
+        return count++;
+    }
+    size_t NumExprs() const { return count; }
+
+    // NULL for an expression whose type is not known yet.
+    Type *TypeOf(uint32_t id) const { Assert(id < count); return types[id]; }
+    void SetType(uint32_t id, Type *t) { Assert(id < count); types[id] = t; }
+
+    // The declaration that a FieldAccess, Call or This names, once it
+    // has been bound (see BindNames in ast_passes.h); NULL before that,
+    // or if it names none. IsBound() tells the two apart, so a name that
+    // names nothing is not looked up again.
+    const Decl *DeclOf(uint32_t id) const
+    {
+        Assert(id < count);
+        return decls[id] == Unresolved() ? NULL : decls[id];
+    }
+    bool IsBound(uint32_t id) const { Assert(id < count); return decls[id] != NULL; }
+    void SetDecl(uint32_t id, const Decl *d)
+    {
+        Assert(id < count);
+        decls[id] = d ? d : Unresolved();
+    }
+
+    // Frees the tables. The expressions made so far can no longer be
+    // asked for their types.
+    void Release();
+
+    // The tables of the compilation running on this thread. Every
+    // expression asks for them, so they are found without a call.
+    static Annotations &Current() { Assert(current != NULL); return *current; }
+
+  private:
+    // Stands in the table for a name bound to nothing.
+    static const Decl *Unresolved() { return (const Decl *)&unresolved; }
+    static const char unresolved;
+
+    friend class PhaseTimer; // sets current along with the compilation
+    static thread_local Annotations *current;
+    void Grow();
+
+    Type **types;
+    const Decl **decls;
+    uint32_t count, capacity;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/* File: arena.cc
+ * --------------
+ * Implementation of the Arena. Chunks start small, so compiling a small
+ * file costs little, and double as the arena fills, up to a limit; an
+ * allocation bigger than a chunk gets a chunk to itself. The chunks come
+ * from operator new, so --phase-stats still shows what a phase took.
+ */
+
+#include "arena.h"
+#include "compilation.h"
+#include <string.h>
+
+static const size_t FirstChunkSize = 64 * 1024;
+static const size_t MaxChunkSize = 4 * 1024 * 1024;
+
+Arena::Arena()
+  : chunks(NULL), next(NULL), limit(NULL), chunkSize(FirstChunkSize),
+    used(0), reserved(0)
+{
+}
+
+Arena::~Arena()
+{
+    while (chunks) {
+        Chunk *c = chunks;
+        chunks = c->next;
+        ::operator delete(c);
+    }
+}
+
+void *Arena::AllocateInNewChunk(size_t size)
+{
+    size_t header = (sizeof(Chunk) + Alignment - 1) & ~(Alignment - 1);
+    size_t length = chunkSize;
+    if (size > length - header)
+        length = size + header;
+    else if (chunkSize < MaxChunkSize)
+        chunkSize *= 2;
+
+    Chunk *c = (Chunk *)::operator new(length); // counted (see allocations.h)
+    c->next = chunks;
+    chunks = c;
+    reserved += length;
+
+    char *p = (char *)c + header;
+    if (length - header - size >= (size_t)(limit - next)) { // keep the roomier
+        next = p + size;
+        limit = (char *)c + length;
+    }
+    used += size;
+    return p;
+}
+
+char *Arena::CopyString(const char *s, size_t len)
+{
+    char *copy = (char *)Allocate(len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+
+Arena *CurrentArena()
+{
+    Compilation *comp = Compilation::Current();
+    return comp ? &comp->arena : NULL;
+}
+
+void *ArenaAllocate(size_t size)
+{
+    Arena *arena = CurrentArena();
+    return arena ? arena->Allocate(size) : ::operator new(size);
+}
+
+char *ArenaStrndup(const char *s, size_t len)
+{
+    Arena *arena = CurrentArena();
+    return arena ? arena->CopyString(s, len) : strndup(s, len);
+}
+
+char *ArenaStrdup(const char *s)
+{
+    return ArenaStrndup(s, strlen(s));
+}
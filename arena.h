@@ -0,0 +1,100 @@
+/* File: arena.h
+ * -------------
+ * This file declares the Arena, the bump allocator that holds a
+ * compilation's syntax tree. Every node, node location, list and string
+ * constant made while a compilation is running comes from that
+ * compilation's arena, one after another in the order the parser builds
+ * them, so a subtree lies together in memory. Nothing in an arena is
+ * freed on its own: when the Compilation goes away, the arena hands its
+ * few large chunks back and the whole tree is gone at once.
+ *
+ * Made with no compilation running (the built-in types, for one), the
+ * same objects simply come from the heap.
+ */
+
+#ifndef _H_arena
+#define _H_arena
+
+#include <stddef.h>   // for size_t
+#include <new>
+
+class Arena
+{
+  public:
+    Arena();
+    ~Arena();    // frees everything allocated from the arena
+
+    // Returns size bytes, aligned for any node.
+    void *Allocate(size_t size)
+    {
+        size = (size + Alignment - 1) & ~(Alignment - 1);
+        if (size > (size_t)(limit - next))
+            return AllocateInNewChunk(size);
+        void *p = next;
+        next += size;
+        used += size;
+        return p;
+    }
+
+    // Returns a NUL-terminated copy of the len characters at s.
+    char *CopyString(const char *s, size_t len);
+
+    size_t BytesUsed() const     { return used; }
+    size_t BytesReserved() const { return reserved; }
+
+  private:
+    static const size_t Alignment = 8; // nothing in the tree needs more
+    struct Chunk { Chunk *next; };
+
+    void *AllocateInNewChunk(size_t size);
+
+    Chunk *chunks;          // most recent first
+    char *next, *limit;     // free space left in the current chunk
+    size_t chunkSize;       // size of the next chunk to get
+    size_t used, reserved;
+};
+
+/* Function: CurrentArena()
+ * ------------------------
+ * Returns the arena of the compilation running on this thread, or NULL
+ * if there is none.
+ */
+Arena *CurrentArena();
+
+/* Function: ArenaAllocate(), ArenaStrdup(), ArenaStrndup()
+ * --------------------------------------------------------
+ * Allocate from the current arena, or from the heap if there is none.
+ */
+void *ArenaAllocate(size_t size);
+char *ArenaStrdup(const char *s);
+char *ArenaStrndup(const char *s, size_t len);
+
+
+/* Class: ArenaAllocator
+ * ---------------------
+ * A standard allocator for containers that live in the tree, such as the
+ * storage behind a List. It takes the arena that is current when it is
+ * made; deallocating from an arena does nothing.
+ */
+template <class T> class ArenaAllocator
+{
+  public:
+    typedef T value_type;
+
+    ArenaAllocator() : arena(CurrentArena()) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+        { return (T *)(arena ? arena->Allocate(n * sizeof(T)) : ::operator new(n * sizeof(T))); }
+    void deallocate(T *p, size_t n)
+        { if (!arena) ::operator delete(p); }
+
+    template <class U> bool operator==(const ArenaAllocator<U> &other) const
+        { return arena == other.arena; }
+    template <class U> bool operator!=(const ArenaAllocator<U> &other) const
+        { return arena != other.arena; }
+
+    Arena *arena;
+};
+
+#endif
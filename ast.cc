@@ -5,17 +5,18 @@
 #include "ast.h"
 #include "ast_type.h"
 #include "ast_decl.h"
-#include <string.h> // strdup
-#include <stdio.h>  // printf
+#include "scope.h"
+#include <stdio.h>  // vfprintf
+#include <stdarg.h>
+#include <algorithm>
 
-Node::Node(yyltype loc) {
-    location = new yyltype(loc);
+Node::Node(NodeKind k, SourceLocation loc) : kind(k) {
+    location = loc;
     parent = NULL;
     level = 0;
 }
 
-Node::Node() {
-    location = NULL;
+Node::Node(NodeKind k) : kind(k) {
     parent = NULL;
     level = 0;
 }
@@ -27,27 +28,152 @@ Node::Node() {
  * and prints the "print name" of the node. It then will invoke the
  * virtual function PrintChildren which is expected to print the
  * internals of the node (itself & children) as appropriate.
+ *
+ * The children that PrintChildren() prints are collected in printQueue
+ * and then pushed onto the stack of nodes still to print, so printing
+ * a tree takes the same C stack however deep it is. A queued item with
+ * no node is text from PrintText(), or a line from PrintLeaf() if it has
+ * a name.
  */
-void Node::Print(int indentLevel, const char *label) { 
+struct PrintItem {
+    Node *node;
+    int indentLevel;
+    const char *label;          // or the text, for PrintText()
+    const char *name, *value;   // for PrintLeaf()
+    SourceLocation location;
+    PrintItem(Node *n, int i, const char *l)
+      : node(n), indentLevel(i), label(l), name(NULL), value(NULL) {}
+};
+static thread_local std::vector<PrintItem> *printQueue = NULL;
+static thread_local FILE *printFile = NULL; // NULL for stdout
+
+void Node::PrintTo(FILE *out) {
+    printFile = out;
+}
+
+void Node::Printf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(printFile ? printFile : stdout, format, args);
+    va_end(args);
+}
+
+static void PrintLine(SourceLocation loc, int indentLevel, const char *label,
+                      const char *name) {
     const int numSpaces = 3;
-    printf("\n");
-    if (GetLocation()) 
-        printf("%*d", numSpaces, GetLocation()->first_line);
+    Node::Printf("\n");
+    if (loc) 
+        Node::Printf("%*d", numSpaces, loc.Line());
     else 
-        printf("%*s", numSpaces, "");
-    printf("%*s%s%s: ", indentLevel*numSpaces, "", 
-           label? label : "", GetPrintNameForNode());
-   PrintChildren(indentLevel);
+        Node::Printf("%*s", numSpaces, "");
+    Node::Printf("%*s%s%s: ", indentLevel*numSpaces, "", 
+           label? label : "", name);
+}
+
+void Node::Print(int indentLevel, const char *label) { 
+    if (printQueue) {
+        printQueue->push_back(PrintItem(this, indentLevel, label));
+        return;
+    }
+    std::vector<PrintItem> stack, children;
+    stack.push_back(PrintItem(this, indentLevel, label));
+    printQueue = &children;
+    while (!stack.empty()) {
+        PrintItem item = stack.back();
+        stack.pop_back();
+        if (!item.node) {
+            if (item.name) {
+                PrintLine(item.location, item.indentLevel, NULL, item.name);
+                Printf("%s", item.value);
+            } else {
+                Printf("%s", item.label);
+            }
+            continue;
+        }
+        Node *node = item.node;
+        PrintLine(node->GetLocation(), item.indentLevel, item.label,
+                  node->GetPrintNameForNode());
+        node->PrintChildren(item.indentLevel);
+        stack.insert(stack.end(), children.rbegin(), children.rend());
+        children.clear();
+    }
+    printQueue = NULL;
 } 
+
+void Node::PrintText(const char *text) {
+    if (printQueue)
+        printQueue->push_back(PrintItem(NULL, 0, text));
+    else
+        Printf("%s", text);
+}
+
+void Node::PrintLeaf(SourceLocation loc, int indentLevel,
+                     const char *name, const char *value) {
+    if (!printQueue) {
+        PrintLine(loc, indentLevel, NULL, name);
+        Printf("%s", value);
+        return;
+    }
+    PrintItem item(NULL, indentLevel, NULL);
+    item.name = name;
+    item.value = value;
+    item.location = loc;
+    printQueue->push_back(item);
+}
+
+void Node::Check() {
+    CheckWalk walk;
+    walk.Run(this);
+}
+
+/* Runs the walk until everything under root has been checked. Each
+ * CheckStep() pushes what it schedules in order, so that is reversed
+ * afterwards to pop in order.
+ */
+void CheckWalk::Run(Node *root) {
+    size_t base = work.size();
+    Check(root);
+    while (work.size() > base) {
+        Entry entry = work.back();
+        work.pop_back();
+        size_t scheduled = work.size();
+        entry.node->CheckStep(this, entry.step);
+        std::reverse(work.begin() + scheduled, work.end());
+    }
+}
+
+/* Climbs to the nearest node with a scope, then goes from scope to
+ * scope: a node between two scopes (a Case) that would stop the search
+ * leaves the inner one with no outer scope.
+ */
+const Decl *Node::getVariable(const char *name) const {
+    const Decl *found = nullptr;
+    const Node *n = this;
+    for (; n != nullptr && n->GetScope() == nullptr; n = n->parent)
+        if (n->LookupHere(name, &found) == Stop)
+            return found;
+    if (n == nullptr)
+        return nullptr;
+    return getVariable(n->GetScope(), name);
+}
+
+const Decl *Node::getVariable(const Scope *scope, const char *name) {
+    const Decl *found = nullptr;
+    for (const Scope *s = scope; s != nullptr; s = s->GetOuter())
+        if (s->GetOwner()->LookupHere(name, &found) == Stop)
+            return found;
+    return nullptr;
+}
 	 
-Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
-    name = strdup(n);
+Identifier::Identifier(SourceLocation loc, const char *n) : Node(IdentifierKind, loc) {
+    Assert(n != NULL);
+    name = n; // already interned by the scanner
 } 
 
 void Identifier::PrintChildren(int indentLevel) {
-    printf("%s", name);
+    Printf("%s", name);
 }
 
-void Identifier::Check() {
+void Identifier::CheckStep(CheckWalk *walk, int step) {
         /* TODO Check if symbol table contains this->name */
 }
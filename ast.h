@@ -7,9 +7,12 @@
  * ForStmt, and AssignExpr).
  * 
  * Location: Each node maintains its lexical location (line and columns in 
- * file), that location can be NULL for those nodes that don't care/use 
+ * file), that location can be empty for those nodes that don't care/use 
  * locations. The location is typcially set by the node constructor.  The 
  * location is used to provide the context when reporting semantic errors.
+ * It is kept as a SourceLocation (see location.h), which is just where
+ * in the text the node is, and is decoded into a line and columns when
+ * an error message needs them.
  *
  * Parent: Each node has a pointer to its parent. For a Program node, the 
  * parent is NULL, for all other nodes it is the pointer to the node one level
@@ -18,38 +21,103 @@
  * instead we wait until assigning the children into the parent node and then 
  * set up links in both directions. The parent link is typically not used 
  * during parsing, but is more important in later phases.
-
+ *
+ * Memory: Nodes and the lists that hold them are made
+ * in the arena of the compilation that is running (see arena.h) and are
+ * never deleted one at a time; the whole tree goes when the Compilation
+ * does. Deleting a node does nothing.
+ *
+ * Walks: Check() and Print() keep their place in the tree on an explicit
+ * work stack rather than on the C stack, and searches up the tree are
+ * loops, so no tree is too deep to check or print however deeply its
+ * statements and expressions nest. Visitors (see ast_visitor.h) walk
+ * the tree the same way.
  */
 
 #ifndef _H_ast
 #define _H_ast
 
 #include <stdlib.h>   // for NULL
+#include <stdio.h>    // for FILE
 #include "location.h"
+#include "arena.h"
+#include "list.h"
 #include <iostream>
-#include <typeinfo>
-#include <map>
-#include <cassert>
+#include <vector>
 
 class Decl;
 class ClassDecl;
 class Type;
+class CheckWalk;
+class Scope;
+
+
+/* Macro: AST_NODE_CLASSES
+ * -----------------------
+ * Applies X to the name of each concrete node class, in the order of a
+ * walk down the class hierarchy. NodeKind is made from it, and so is
+ * anything else that has to do something for every kind of node, such
+ * as the switch a Visitor (see ast_visitor.h) dispatches on.
+ */
+#define AST_NODE_CLASSES(X) \
+    X(Identifier) X(Error) X(Program) X(Case) \
+    X(VarDecl) X(ClassDecl) X(InterfaceDecl) X(FnDecl) \
+    X(StmtBlock) X(ForStmt) X(WhileStmt) X(IfStmt) X(BreakStmt) \
+    X(ReturnStmt) X(PrintStmt) X(SwitchStmt) \
+    X(EmptyExpr) X(IntConstant) X(DoubleConstant) X(BoolConstant) \
+    X(StringConstant) X(NullConstant) X(ArithmeticExpr) \
+    X(RelationalExpr) X(EqualityExpr) X(LogicalExpr) X(AssignExpr) \
+    X(ArrayAccess) X(FieldAccess) X(This) X(Call) X(NewExpr) \
+    X(NewArrayExpr) X(ReadIntegerExpr) X(ReadLineExpr) \
+    X(PostfixExpr) \
+    X(Type) X(NamedType) X(ArrayType)
+
+/* Enum: NodeKind
+ * --------------
+ * Which concrete class a node is; the kind of class C is CKind. The
+ * kinds are in the order of AST_NODE_CLASSES, so the kinds of any class
+ * and all its subclasses are consecutive, and the classof() of a class
+ * (see isa<> below) only has to compare a node's kind with the ends of
+ * its range.
+ */
+enum NodeKind {
+#define NODE_KIND(C) C##Kind,
+    AST_NODE_CLASSES(NODE_KIND)
+#undef NODE_KIND
+
+    FirstDeclKind = VarDeclKind,            LastDeclKind = FnDeclKind,
+    FirstStmtKind = StmtBlockKind,          LastStmtKind = PostfixExprKind,
+    FirstConditionalStmtKind = ForStmtKind, LastConditionalStmtKind = IfStmtKind,
+    FirstLoopStmtKind = ForStmtKind,        LastLoopStmtKind = WhileStmtKind,
+    FirstExprKind = EmptyExprKind,          LastExprKind = PostfixExprKind,
+    FirstCompoundExprKind = ArithmeticExprKind,
+                                            LastCompoundExprKind = AssignExprKind,
+    FirstLValueKind = ArrayAccessKind,      LastLValueKind = FieldAccessKind,
+    FirstTypeKind = TypeKind,               LastTypeKind = ArrayTypeKind
+};
 
 class Node 
 {
+    friend class AstImage; // saves and rebuilds the tree (see ast_image.h)
   protected:
-    yyltype *location;
+    SourceLocation location;
     Node *parent;
     int level;
+    const unsigned char kind; // a NodeKind, in the padding after level
 
   public:
-    Node(yyltype loc);
-    Node();
+    Node(NodeKind kind, SourceLocation loc);
+    Node(NodeKind kind);
+
+    NodeKind GetKind() const { return (NodeKind)kind; }
+
+    static void *operator new(size_t size) { return ArenaAllocate(size); }
+    static void operator delete(void *p) {}
 
     void addLevel() {level++; }//std::cout << level;}
     int getLevel() {return level;}
     void setLevel(int l) {level = l;}
-    yyltype *GetLocation() const { return location; }
+    SourceLocation GetLocation() const { return location; }
     void SetParent(Node *p)  { parent = p; }
     Node *GetParent()        { return parent; }
     virtual bool isBreakable() {return false;}
@@ -58,33 +126,142 @@ class Node
     
     // Print() is deliberately _not_ virtual
     // subclasses should override PrintChildren() instead
+    // A Print() made from inside PrintChildren() only queues the child;
+    // it is printed once PrintChildren() returns, so a PrintChildren()
+    // that has something to print after its children uses PrintText().
     void Print(int indentLevel, const char *label = NULL); 
     virtual void PrintChildren(int indentLevel)  {}
-    virtual void Check() = 0;
+    static void PrintText(const char *text);
+    // Print() writes on stdout, or on the file last given to PrintTo()
+    // on this thread (NULL for stdout again). PrintChildren() writes
+    // its own text with Printf() so that it goes to the same place.
+    static void PrintTo(FILE *out);
+    static void Printf(const char *format, ...);
+    // Prints a line like the one for a childless node named name that
+    // prints value, for a part of a node that is not a node of its own
+    // (the operator of an expression, say). value has to last until
+    // the queued line has been printed.
+    static void PrintLeaf(SourceLocation loc, int indentLevel,
+                          const char *name, const char *value);
+
+    // Adds the node's children to the end of children, in the order
+    // Print() prints them. Not virtual: a walk finds the right one by
+    // the node's kind (see ast_visitor.h), so each subclass with
+    // children of its own hides this one with its own.
+    void AppendChildren(std::vector<Node *> *children) {}
+
+    // Check() is _not_ virtual either: it checks this node and everything
+    // under it with a CheckWalk. Subclasses override CheckStep() instead.
+    void Check();
+    virtual void CheckStep(CheckWalk *walk, int step) = 0;
 
     /**
-     * Returns a Decl pointer by searching up the tree
+     * Returns a Decl pointer by searching up the tree. The name must be
+     * interned (see intern.h); names are compared by pointer.
      */
-    virtual const Decl *getVariable(const char *name) const { return nullptr; }
+    const Decl *getVariable(const char *name) const;
 
     /**
-     * Returns a pointer to 'this' by searching up the tree
+     * The same search, starting from scope (the one of the nearest node
+     * around the use that has one, or NULL inside a switch case).
      */
-    virtual const ClassDecl *getThis() const { return nullptr; }
+    static const Decl *getVariable(const Scope *scope, const char *name);
+
+  protected:
+    // What a node tells a search up the tree: the answer is here (which
+    // may be NULL), or go on to the parent. The search stops at nodes
+    // that don't say otherwise.
+    enum Search { Stop, Continue };
+    virtual Search LookupHere(const char *name, const Decl **found) const
+        { *found = nullptr; return Stop; }
+    // The table of names declared here, for the nodes that have one.
+    // From it, a search goes on to the next scope out without visiting
+    // the nodes in between.
+    virtual const Scope *GetScope() const { return nullptr; }
+};
+
+
+/* Functions: isa<>(), cast<>(), dyn_cast<>()
+ * ------------------------------------------
+ * Checked downcasts on node kinds, used instead of dynamic_cast:
+ * isa<FnDecl>(node) says whether node is an FnDecl, cast<FnDecl>(node)
+ * converts a node known to be one (asserting that it is), and
+ * dyn_cast<FnDecl>(node) converts it if it is one and gives NULL if not.
+ * A class T works with them if it has a static T::classof(const Node *).
+ * Like dynamic_cast, isa<> and dyn_cast<> accept a NULL node (which is
+ * nothing), since they are often handed the result of a search.
+ */
+template <class T> inline bool isa(const Node *node)
+{
+    return node != NULL && T::classof(node);
+}
+
+template <class T> inline T *cast(Node *node)
+{
+    Assert(isa<T>(node));
+    return static_cast<T *>(node);
+}
+
+template <class T> inline const T *cast(const Node *node)
+{
+    Assert(isa<T>(node));
+    return static_cast<const T *>(node);
+}
+
+template <class T> inline T *dyn_cast(Node *node)
+{
+    return isa<T>(node) ? static_cast<T *>(node) : NULL;
+}
+
+template <class T> inline const T *dyn_cast(const Node *node)
+{
+    return isa<T>(node) ? static_cast<const T *>(node) : NULL;
+}
+
+
+/* Class: CheckWalk
+ * ----------------
+ * The work stack that Node::Check() runs on. Each entry is a node and
+ * the step of its CheckStep() to run next; a node's checks start at
+ * step 0. A CheckStep() that needs a child checked before it can carry
+ * on schedules the child with Check(), schedules the rest of its own
+ * work with Then(), and returns. Whatever one CheckStep() schedules is
+ * run in the order it was scheduled, each child's subtree completely,
+ * before anything that was already on the stack.
+ */
+class CheckWalk
+{
+  public:
+    void Check(Node *node)              { work.push_back(Entry(node, 0)); }
+    void Then(Node *node, int step)     { work.push_back(Entry(node, step)); }
+    template <class Element, int N> void CheckAll(List<Element, N> *list);
+
+    void Run(Node *root);
+
+  private:
+    struct Entry {
+        Node *node;
+        int step;
+        Entry(Node *n, int s) : node(n), step(s) {}
+    };
+    std::vector<Entry> work;
 };
 
 
+// The name of an Identifier is interned (see intern.h), so two
+// identifiers name the same thing exactly when GetName() pointers match.
 class Identifier : public Node 
 {
   protected:
-    char *name;
+    const char *name;
     
   public:
-    Identifier(yyltype loc, const char *name);
+    Identifier(SourceLocation loc, const char *internedName);
+    static bool classof(const Node *n) { return n->GetKind() == IdentifierKind; }
     const char *GetPrintNameForNode()   { return "Identifier"; }
     const char *GetName() const { return name; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 
@@ -96,10 +273,16 @@ class Identifier : public Node
 class Error : public Node
 {
   public:
-    Error() : Node() {}
+    Error() : Node(ErrorKind) {}
     const char *GetPrintNameForNode()   { return "Error"; }
 };
 
 
 
+template <class Element, int N> void CheckWalk::CheckAll(List<Element, N> *list)
+{
+    for (Element elem : *list)
+        Check(elem);
+}
+
 #endif
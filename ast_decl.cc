@@ -7,11 +7,16 @@
 #include "ast_stmt.h"
 #include "symbols.h"
 #include "errors.h"
+#include "scope.h"
+#include "intern.h"
+#include <cassert>
 #include <iostream>
+#include <string.h>
+#include <unordered_map>
 
 using namespace std;
 
-Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
+Decl::Decl(NodeKind k, Identifier *n) : Node(k, n->GetLocation()) {
     Assert(n != NULL);
     (id=n)->SetParent(this);
     if(parent != nullptr)
@@ -25,7 +30,7 @@ Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
 }
 
 
-VarDecl::VarDecl(Identifier *n, Type *t) : Decl(n) {
+VarDecl::VarDecl(Identifier *n, Type *t) : Decl(VarDeclKind, n) {
     Assert(n != NULL && t != NULL);
     (type=t)->SetParent(this);
     //std::cout << n->GetName() << " LEVEL " << level << std::endl;
@@ -36,13 +41,25 @@ void VarDecl::PrintChildren(int indentLevel) {
    id->Print(indentLevel+1);
 }
 
-ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<Decl*> *m) : Decl(n) {
+void VarDecl::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(type);
+    children->push_back(id);
+}
+
+ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*, 1> *imp, List<Decl*> *m) : Decl(ClassDeclKind, n) {
     // extends can be NULL, impl & mem may be empty lists but cannot be NULL
     Assert(n != NULL && imp != NULL && m != NULL);     
     extends = ex;
     if (extends) extends->SetParent(this);
     (implements=imp)->SetParentAll(this);
     (members=m)->SetParentAll(this);
+    scope = NULL;
+    memberTable = NULL;
+    superclass = NULL;
+    pre = low = post = -1;
+    interfaces = NULL;
+    index = -1;
+    type = NULL;
 }
 
 void ClassDecl::PrintChildren(int indentLevel) {
@@ -52,23 +69,45 @@ void ClassDecl::PrintChildren(int indentLevel) {
     members->PrintAll(indentLevel+1);
 }
 
+void ClassDecl::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(id);
+    if (extends) children->push_back(extends);
+    children->insert(children->end(), implements->begin(), implements->end());
+    children->insert(children->end(), members->begin(), members->end());
+}
+
 
-InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(n) {
+InterfaceDecl::InterfaceDecl(Identifier *n, List<Decl*> *m) : Decl(InterfaceDeclKind, n) {
     Assert(n != NULL && m != NULL);
     (members=m)->SetParentAll(this);
-    declared_interfaces.Enter(n->GetName(), this);
+    scope = NULL;
+    index = -1;
 }
 
 void InterfaceDecl::PrintChildren(int indentLevel) {
     id->Print(indentLevel+1);
     members->PrintAll(indentLevel+1);
 }
+
+void InterfaceDecl::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(id);
+    children->insert(children->end(), members->begin(), members->end());
+}
 	
-FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*> *d) : Decl(n) {
+FnDecl::FnDecl(Identifier *n, Type *r, List<VarDecl*, 2> *d) : Decl(FnDeclKind, n) {
     Assert(n != NULL && r!= NULL && d != NULL);
     (returnType=r)->SetParent(this);
     (formals=d)->SetParentAll(this);
     body = NULL;
+    scope = NULL;
+    string spelling = returnType->getTypeName();
+    spelling += '(';
+    for (int i = 0; i < formals->NumElements(); i++) {
+        if (i > 0) spelling += ',';
+        spelling += formals->Nth(i)->getType()->getTypeName();
+    }
+    spelling += ')';
+    signature = Intern(spelling.c_str());
 }
 
 void FnDecl::SetFunctionBody(Stmt *b) { 
@@ -83,26 +122,26 @@ void FnDecl::PrintChildren(int indentLevel) {
     if (body) body->Print(indentLevel+1, "(body) ");
 }
 
-void FnDecl::Check() {
+void FnDecl::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(returnType);
+    children->push_back(id);
+    children->insert(children->end(), formals->begin(), formals->end());
+    if (body) children->push_back(body);
+}
+
+void FnDecl::CheckStep(CheckWalk *walk, int step) {
         
         //Check to see if name has already been used.
-        ClassDecl* check = dynamic_cast<ClassDecl*>(parent);
+        ClassDecl* check = dyn_cast<ClassDecl>(parent);
         if(parent->getVariable(id->GetName())->GetLocation() != location && (check == nullptr))
         {
-            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation()->first_line);
-        }
-        int i = 0;
-
-        while (i < formals->NumElements())
-        {
-                formals->Nth(i)->setLevel(level);
-                formals->Nth(i)->Check();
-                i++;
+            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation().Line());
         }
+        walk->CheckAll(formals);
 
         if (body == nullptr)
         {
-                if (dynamic_cast<InterfaceDecl*>(parent) == nullptr)
+                if (!isa<InterfaceDecl>(parent))
                 {
                         /* there's an error here */
                         assert(0);
@@ -110,185 +149,191 @@ void FnDecl::Check() {
         }
         else
         {
-                body->Check();
+                walk->Check(body);
         }
 
-        returnType->Check();
+        walk->Check(returnType);
 }
 
-void InterfaceDecl::Check() {
-        Decl::Check();
-
-        if (parent->getVariable(id->GetName())->GetLocation() != location)
+void InterfaceDecl::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
         {
-            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation()->first_line);
+                Decl::CheckStep(walk, 0);
+                walk->Then(this, 1);
+                return;
         }
 
-        int i = 0;
-
-        while (i < members->NumElements())
+        if (parent->getVariable(id->GetName())->GetLocation() != location)
         {
-                members->Nth(i)->Check();
-                i++;
+            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation().Line());
         }
+
+        walk->CheckAll(members);
 }
 
-void Decl::Check() {
-        id->Check();
+void Decl::CheckStep(CheckWalk *walk, int step) {
+        walk->Check(id);
 }
 
-void VarDecl::Check() {
-        Decl::Check();
+void VarDecl::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                Decl::CheckStep(walk, 0);
+                walk->Then(this, 1);
+                return;
+        }
         if(parent->getVariable(id->GetName())->GetLocation() != location)
         {
-            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation()->first_line);
+            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation().Line());
         }
 
-        type->Check();
+        walk->Check(type);
 }
 
-void ClassDecl::Check() {
-        Decl::Check();
-
-        if (parent->getVariable(id->GetName())->GetLocation() != location)
-        {
-            ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation()->first_line);
-        }
-
+void ClassDecl::CheckStep(CheckWalk *walk, int step) {
         int i = 0;
+        vector<int> repeat;
 
-        for (i = 0; i < implements->NumElements(); i++)
+        switch (step)
         {
-                const InterfaceDecl *iface =
-                        dynamic_cast<const InterfaceDecl*>(
-                                        parent->getVariable(implements->Nth(i)->getTypeName())
-                                        );
+        case 0:
+                Decl::CheckStep(walk, 0);
+                walk->Then(this, 1);
+                return;
 
-                if (iface == nullptr)
+        case 1:
+                if (parent->getVariable(id->GetName())->GetLocation() != location)
                 {
-                        ReportError::Formatted(implements->Nth(i)->GetLocation(),
-                                        "No declaration found for interface '%s'",
-                                        implements->Nth(i)->getTypeName());
-                        continue;
+                    ReportError::Formatted(location, "Declaration of '%s' here conflicts with declaration on line %d",id->GetName(),parent->getVariable(id->GetName())->GetLocation().Line());
                 }
 
-                for (int j = 0; j < iface->numMembers(); j++)
+                // The interfaces named again further on, and where.
+                repeat.assign(implements->NumElements(), -1);
+                if (implements->NumElements() > 1)
                 {
-                        const FnDecl *myFn = nullptr;
-                        const FnDecl *ifaceFn = dynamic_cast<const FnDecl*>(
-                                        iface->getMember(j));
-
-                        myFn = dynamic_cast<const FnDecl*>(
-                                        getVariable(ifaceFn->getName()));
-
-                        if (myFn == nullptr)
+                        unordered_map<const char *, int> later;
+                        for (i = implements->NumElements() - 1; i >= 0; i--)
                         {
-                                ReportError::Formatted(implements->Nth(i)->GetLocation(),
-                                                "Class '%s' does not implement entire interface '%s'",
-                                                id->GetName(),
-                                                iface->getName());
-                                break;
+                                pair<unordered_map<const char *, int>::iterator, bool> seen =
+                                        later.insert(make_pair(implements->Nth(i)->getTypeName(), i));
+                                if (!seen.second)
+                                {
+                                        repeat[i] = seen.first->second;
+                                        seen.first->second = i;
+                                }
                         }
                 }
 
-                for (int j = 0; j < iface->numMembers(); j++)
+                for (i = 0; i < implements->NumElements(); i++)
                 {
-                        const FnDecl *myFn = nullptr;
-                        const FnDecl *ifaceFn = dynamic_cast<const FnDecl*>(
-                                        iface->getMember(j));
-                        if (ifaceFn == nullptr)
+                        const InterfaceDecl *iface =
+                                dyn_cast<InterfaceDecl>(
+                                                parent->getVariable(implements->Nth(i)->getTypeName())
+                                                );
+
+                        if (iface == nullptr)
                         {
-                                assert(0);
+                                ReportError::Formatted(implements->Nth(i)->GetLocation(),
+                                                "No declaration found for interface '%s'",
+                                                implements->Nth(i)->getTypeName());
+                                continue;
                         }
 
-                        for (int k = 0; k < members->NumElements(); k++)
+                        for (int j = 0; j < iface->numMembers(); j++)
                         {
-                                if (strcmp(members->Nth(k)->getName(),
-                                                        ifaceFn->getName()) == 0)
+                                const FnDecl *myFn = nullptr;
+                                const FnDecl *ifaceFn = dyn_cast<FnDecl>(
+                                                iface->getMember(j));
+
+                                myFn = dyn_cast<FnDecl>(
+                                                getVariable(ifaceFn->getName()));
+
+                                if (myFn == nullptr)
                                 {
-                                        myFn = dynamic_cast<FnDecl*>(
-                                                        members->Nth(k));
-                                        assert(myFn);
+                                        ReportError::Formatted(implements->Nth(i)->GetLocation(),
+                                                        "Class '%s' does not implement entire interface '%s'",
+                                                        id->GetName(),
+                                                        iface->getName());
                                         break;
                                 }
                         }
-                        myFn = dynamic_cast<const FnDecl*>(
-                                        getVariable(ifaceFn->getName()));
 
-                        if (myFn != nullptr && !myFn->signatureEqual(ifaceFn))
+                        for (int j = 0; j < iface->numMembers(); j++)
                         {
-                                int z = 0;
-                                for (z = 0; z < numMembers(); z++)
+                                const FnDecl *myFn = nullptr;
+                                const FnDecl *ifaceFn = dyn_cast<FnDecl>(
+                                                iface->getMember(j));
+                                if (ifaceFn == nullptr)
                                 {
-                                        if (getMember(z) == myFn)
-                                        {
-                                                break;
-                                        }
+                                        assert(0);
                                 }
 
-                                if (z != numMembers())
+                                // A member of the class by that name must be a method.
+                                const Decl *member = scope->Lookup(ifaceFn->getName());
+                                if (member != nullptr)
                                 {
-                                        ReportError::Formatted(myFn->GetLocation(),
-                                                        "Method '%s' must match inherited type signature",
-                                                        myFn->getName());
+                                        assert(dyn_cast<FnDecl>(member));
                                 }
-                                else
+                                myFn = dyn_cast<FnDecl>(
+                                                getVariable(ifaceFn->getName()));
+
+                                if (myFn != nullptr && !myFn->signatureEqual(ifaceFn))
                                 {
-                                        ReportError::Formatted(implements->Nth(i)->GetLocation(),
-                                                        "Class '%s' does not implement entire interface '%s'",
-                                                        getName(),
-                                                        iface->getName());
+                                        if (scope->Lookup(myFn->getName()) == myFn)
+                                        {
+                                                ReportError::Formatted(myFn->GetLocation(),
+                                                                "Method '%s' must match inherited type signature",
+                                                                myFn->getName());
+                                        }
+                                        else
+                                        {
+                                                ReportError::Formatted(implements->Nth(i)->GetLocation(),
+                                                                "Class '%s' does not implement entire interface '%s'",
+                                                                getName(),
+                                                                iface->getName());
+                                        }
                                 }
                         }
-                }
 
-                for (int j = i; j < implements->NumElements(); j++)
-                {
-                        if (i != j)
+                        if (repeat[i] >= 0)
                         {
-                                if (strcmp(implements->Nth(i)->getTypeName(),
-                                                        implements->Nth(j)->getTypeName()) == 0)
-                                {
-                                        ReportError::Formatted(implements->Nth(j)->GetLocation(),
-                                                        "Class '%s' repeated interface '%s'",
-                                                        getName(),
-                                                        implements->Nth(j)->getTypeName());
-                                        return;
-                                }
+                                ReportError::Formatted(implements->Nth(repeat[i])->GetLocation(),
+                                                "Class '%s' repeated interface '%s'",
+                                                getName(),
+                                                implements->Nth(repeat[i])->getTypeName());
+                                return;
                         }
                 }
-        }
 
-        if (extends != nullptr)
-        {
-                extends->Check();
+                if (extends != nullptr)
+                {
+                        walk->Check(extends);
+                        walk->Then(this, 2);
+                        return;
+                }
+                break;
 
-                const ClassDecl *supercls = dynamic_cast<const ClassDecl*>(
-                                parent->getVariable(extends->getTypeName())
-                                );
+        case 2:
+                /* extends has been checked */
+                const ClassDecl *supercls = superclass;
 
                 if (supercls != nullptr)
                 {
                         for (int j = 0; j < supercls->numMembers(); j++)
                         {
-                                FnDecl *myFn = nullptr;
-                                const FnDecl *ifaceFn = dynamic_cast<const FnDecl*>(
+                                const FnDecl *myFn = nullptr;
+                                const FnDecl *ifaceFn = dyn_cast<FnDecl>(
                                                 supercls->getMember(j));
                                 if (ifaceFn == nullptr)
                                 {
                                         continue;
                                 }
 
-                                for (int k = 0; k < members->NumElements(); k++)
+                                const Decl *member = scope->Lookup(ifaceFn->getName());
+                                if (member != nullptr)
                                 {
-                                        if (strcmp(members->Nth(k)->getName(),
-                                                                ifaceFn->getName()) == 0)
-                                        {
-                                                myFn = dynamic_cast<FnDecl*>(
-                                                                members->Nth(k));
-                                                assert(myFn);
-                                                break;
-                                        }
+                                        myFn = dyn_cast<FnDecl>(member);
+                                        assert(myFn);
                                 }
 
                                 if (myFn != nullptr && !myFn->signatureEqual(ifaceFn))
@@ -299,103 +344,195 @@ void ClassDecl::Check() {
                                 }
                         }
                 }
+                break;
         }
 
+        i = implements->NumElements(); // where the loop in step 1 left it
         while (i < members->NumElements())
         {
-                members->Nth(i)->Check();
+                walk->Check(members->Nth(i));
                 i++;
         }
 }
 
-bool FnDecl::signatureEqual(const FnDecl *other) const
+const Decl *InterfaceDecl::getMember(int i) const
 {
-        if (returnType->operator!=(other->returnType))
+        return members->Nth(i);
+}
+
+int InterfaceDecl::numMembers() const
+{
+        return members->NumElements();
+}
+
+void ClassDecl::BuildScope(const Scope *outer)
+{
+        scope = new Scope(this, outer, members->NumElements());
+        for (Decl *d : *members)
         {
-                return false;
+                scope->Declare(d);
         }
+        // One type for every 'this' in the class, bound to it already
+        type = new NamedType(new Identifier(id->GetLocation(), id->GetName()), this);
+        type->SetParent(this);
+}
 
-        if (formals->NumElements() != other->formals->NumElements())
+void InterfaceDecl::BuildScope(const Scope *outer)
+{
+        scope = new Scope(this, outer, members->NumElements());
+        for (Decl *d : *members)
         {
-                return false;
+                scope->Declare(d);
         }
+}
 
-        for (int i = 0; i < formals->NumElements(); i++)
+void FnDecl::BuildScope(const Scope *outer)
+{
+        scope = new Scope(this, outer, formals->NumElements());
+        for (VarDecl *d : *formals)
         {
-                if (formals->Nth(i)->getType()->operator!=(
-                                        other->formals->Nth(i)->getType()))
-                {
-                        return false;
-                }
+                scope->Declare(d);
         }
-
-        return true;
 }
 
-const Decl *InterfaceDecl::getMember(int i) const
+/* ClassDecl::BuildMemberTables
+ * ----------------------------
+ * The superclass's members come before the class's own, and a global
+ * comes before a member declared in a class that has a superclass: the
+ * search through the superclass used to end at the program before it
+ * got back to the class. The member tables answer for all of that.
+ *
+ * A class's table holds only what the class adds to its superclass's,
+ * and its outer scope is the superclass's table, so a chain of classes
+ * takes room in proportion to the members declared along it. A class
+ * that adds nothing shares its superclass's table.
+ *
+ * The tables are made from the top of each chain down, without
+ * recursion, as a chain can be any length. A chain that comes round in
+ * a cycle ends at the class where it came round, with that class's own
+ * scope standing in for its table (as it did while the class's table
+ * was being made).
+ */
+void ClassDecl::BuildMemberTables(List<Decl*> *decls)
 {
-        return members->Nth(i);
+        vector<ClassDecl *> climb;
+        for (Decl *d : *decls)
+        {
+                ClassDecl *cls = dyn_cast<ClassDecl>(d);
+                if (cls == nullptr || cls->memberTable != nullptr)
+                {
+                        continue;
+                }
+
+                // Up to the top, a class whose table is made or one
+                // already in the climb.
+                ClassDecl *next = cls;
+                while (next != nullptr && next->memberTable == nullptr)
+                {
+                        Assert(next->scope != nullptr);
+                        next->memberTable = next->scope; // until it is made
+                        climb.push_back(next);
+                        next = next->Extended();
+                }
+                while (!climb.empty())
+                {
+                        ClassDecl *c = climb.back();
+                        climb.pop_back();
+                        c->superclass = next;
+                        c->MakeMemberTable();
+                        next = c;
+                }
+        }
 }
 
-int InterfaceDecl::numMembers() const
+/* The class named by extends, unless there is none or it is this one. */
+ClassDecl *ClassDecl::Extended() const
 {
-        return members->NumElements();
+        if (extends == nullptr)
+        {
+                return nullptr;
+        }
+        const ClassDecl *super = dyn_cast<ClassDecl>(
+                        parent->getVariable(extends->getTypeName()));
+        // the program's classes are ours to finish
+        return super != this ? const_cast<ClassDecl *>(super) : nullptr;
 }
 
-const Decl * ClassDecl::getVariable(const char *name) const
+void ClassDecl::MakeMemberTable()
 {
-        const Decl* retVal;
-        if (extends != nullptr)
+        const Scope *globals = scope->GetOuter();
+        Scope *table;
+        if (superclass == nullptr)
         {
-                const ClassDecl *super = dynamic_cast<const ClassDecl*>(
-                                parent->getVariable(extends->getTypeName()));
-                if (super != nullptr)
+                table = new Scope(this, nullptr, scope->NumDecls());
+                table->DeclareAll(scope);
+        }
+        else if (superclass->memberTable == superclass->scope)
+        {
+                // where a cycle comes round
+                table = new Scope(this, nullptr,
+                                superclass->scope->NumDecls() + scope->NumDecls());
+                table->DeclareAll(superclass->scope);
+                for (Decl *d : *members)
                 {
-                        retVal = super->getVariable(name);
-                        if(retVal != nullptr)
-                        {
-                            return retVal;
-                        }
+                        const Decl *global = globals->Lookup(d->getName());
+                        table->Declare(global != nullptr ? global : d);
                 }
         }
-        //cout << id->GetName() << endl;
-        for (int i = 0; i < members->NumElements(); i++)
+        else
         {
-                if (strcmp(members->Nth(i)->getName(), name) == 0)
+                vector<const Decl *> added;
+                for (Decl *d : *members)
                 {
-                        return members->Nth(i);
+                        if (superclass->LookupMember(d->getName()) == nullptr)
+                        {
+                                const Decl *global = globals->Lookup(d->getName());
+                                added.push_back(global != nullptr ? global : d);
+                        }
+                }
+                if (added.empty())
+                {
+                        memberTable = superclass->memberTable;
+                        return;
+                }
+                table = new Scope(this, superclass->memberTable, added.size());
+                for (const Decl *d : added)
+                {
+                        table->Declare(d);
                 }
         }
-
-        return parent->getVariable(name);
+        memberTable = table;
 }
 
-const Decl * FnDecl::getVariable(const char *name) const
+const Decl *ClassDecl::LookupMember(const char *name) const
 {
-        for (int i = 0; i < formals->NumElements(); i++)
+        for (const Scope *t = memberTable; t != nullptr; t = t->GetOuter())
         {
-                if (strcmp(formals->Nth(i)->getName(), name) == 0)
+                if (const Decl *found = t->Lookup(name))
                 {
-                        return formals->Nth(i);
+                        return found;
                 }
         }
-
-        return parent->getVariable(name);
+        return nullptr;
 }
 
-const Decl * VarDecl::getVariable(const char *name) const
+Node::Search ClassDecl::LookupHere(const char *name, const Decl **found) const
 {
-        return parent->getVariable(name);
+        Assert(memberTable != nullptr);
+        *found = LookupMember(name);
+        return *found != nullptr ? Stop : Continue;
 }
 
-const ClassDecl *ClassDecl::getThis() const
+Node::Search FnDecl::LookupHere(const char *name, const Decl **found) const
 {
-        return this;
+        Assert(scope != nullptr);
+        *found = scope->Lookup(name);
+        return *found != nullptr ? Stop : Continue;
 }
 
-const ClassDecl *FnDecl::getThis() const
+Node::Search VarDecl::LookupHere(const char *name, const Decl **found) const
 {
-        return parent->getThis();
+        return Continue;
 }
 
 const Type *FnDecl::formalType(int i) const
@@ -418,48 +555,221 @@ int FnDecl::NumFormals() const
         return 0;
 }
 
-const Decl *InterfaceDecl::getVariable(const char *name) const
+Node::Search InterfaceDecl::LookupHere(const char *name, const Decl **found) const
 {
-        for (int i = 0; i < members->NumElements(); i++)
-        {
-                if (strcmp(members->Nth(i)->getName(), name) == 0)
-                {
-                        return members->Nth(i);
-                }
-        }
-
-        return parent->getVariable(name);
+        Assert(scope != nullptr);
+        *found = scope->Lookup(name);
+        return *found != nullptr ? Stop : Continue;
 }
 
-bool Decl::descendedFrom(const char *name) const
+bool Decl::descendedFrom(const Decl *other) const
 {
         return false;
 }
 
-bool ClassDecl::descendedFrom(const char *name) const
+bool ClassDecl::descendedFrom(const Decl *other) const
 {
-        if (extends != nullptr)
+        Assert(pre >= 0);
+        if (const ClassDecl *cls = dyn_cast<ClassDecl>(other))
         {
-                if (strcmp(extends->getTypeName(), name) == 0)
+                if (cls != this && cls->low <= pre && pre <= cls->post)
                 {
                         return true;
                 }
+                // Named in an implements list, it is taken as an interface.
+                return cls->index >= 0 && interfaces != nullptr &&
+                        (interfaces[cls->index / 64] >> (cls->index % 64) & 1);
+        }
+        if (const InterfaceDecl *iface = dyn_cast<InterfaceDecl>(other))
+        {
+                return interfaces != nullptr &&
+                        (interfaces[iface->index / 64] >> (iface->index % 64) & 1);
+        }
+        return false;
+}
 
-                if (parent->getVariable(extends->getTypeName())->descendedFrom(name))
+/* ClassDecl::NumberClasses
+ * ------------------------
+ * Numbers the classes depth first down from each class without a
+ * superclass, so that the subclasses of a class, however deep, are
+ * numbered from just after it to its post. A class then descends from
+ * another if its number is in the other's range.
+ *
+ * A cycle of classes is walked from one of its classes, and every class
+ * in the cycle gets that class's whole range, for in a cycle each class
+ * descends from all the others. Each class also gets the set of the
+ * interfaces that it or a class above it implements or extends. That is
+ * an error when an implements list names a class, but the class that
+ * names it is still its subtype, so such a class gets a bit in the set
+ * after the interfaces.
+ */
+void ClassDecl::NumberClasses(List<Decl*> *decls)
+{
+        vector<ClassDecl *> classes;
+        int numInterfaces = 0;
+        for (Decl *d : *decls)
+        {
+                if (ClassDecl *cls = dyn_cast<ClassDecl>(d))
                 {
-                        return true;
+                        cls->pre = classes.size(); // its index, for now
+                        classes.push_back(cls);
+                }
+                else if (InterfaceDecl *iface = dyn_cast<InterfaceDecl>(d))
+                {
+                        iface->index = numInterfaces++;
                 }
         }
 
-        for (int i = 0; i < implements->NumElements(); i++)
+        for (ClassDecl *cls : classes)
         {
-                if (strcmp(implements->Nth(i)->getTypeName(), name) == 0)
+                for (NamedType *type : *cls->implements)
                 {
-                        return true;
+                        const ClassDecl *named = dyn_cast<ClassDecl>(
+                                        cls->parent->getVariable(type->getTypeName()));
+                        if (named != nullptr && named->index < 0)
+                        {
+                                classes[named->pre]->index = numInterfaces++;
+                        }
                 }
         }
 
-        return false;
+        int n = classes.size();
+        vector<int> super(n, -1), number(n, -1), last(n), order;
+        vector<vector<int> > subclasses(n);
+        for (int i = 0; i < n; i++)
+        {
+                if (classes[i]->superclass != nullptr)
+                {
+                        super[i] = classes[i]->superclass->pre;
+                        subclasses[super[i]].push_back(i);
+                }
+        }
+
+        // The walk, without recursion, as a chain can be any length.
+        vector<pair<int, size_t> > stack;
+        auto walk = [&](int root) {
+                number[root] = order.size();
+                order.push_back(root);
+                stack.push_back(make_pair(root, 0));
+                while (!stack.empty())
+                {
+                        int i = stack.back().first;
+                        if (stack.back().second == subclasses[i].size())
+                        {
+                                last[i] = order.size() - 1;
+                                stack.pop_back();
+                                continue;
+                        }
+                        int sub = subclasses[i][stack.back().second++];
+                        if (number[sub] < 0)
+                        {
+                                number[sub] = order.size();
+                                order.push_back(sub);
+                                stack.push_back(make_pair(sub, 0));
+                        }
+                }
+        };
+        for (int i = 0; i < n; i++)
+        {
+                if (super[i] < 0)
+                {
+                        walk(i);
+                }
+        }
+
+        // What is left is in a cycle or below one. Going up from it leads
+        // round the cycle; the class that comes round again is in it.
+        vector<int> seen(n, -1), cycleOf(n, -1);
+        for (int i = 0; i < n; i++)
+        {
+                if (number[i] >= 0)
+                {
+                        continue;
+                }
+                int j = i;
+                while (seen[j] != i)
+                {
+                        seen[j] = i;
+                        j = super[j];
+                }
+                walk(j);
+                int k = j;
+                do
+                {
+                        cycleOf[k] = j;
+                        k = super[k];
+                } while (k != j);
+        }
+
+        int words = (numInterfaces + 63) / 64;
+        for (int i : order)
+        {
+                ClassDecl *cls = classes[i];
+                cls->pre = number[i];
+                if (cycleOf[i] >= 0)
+                {
+                        cls->low = number[cycleOf[i]];
+                        cls->post = last[cycleOf[i]];
+                }
+                else
+                {
+                        cls->low = number[i];
+                        cls->post = last[i];
+                }
+
+                if (words == 0)
+                {
+                        continue;
+                }
+                cls->interfaces = (uint64_t *)ArenaAllocate(words * sizeof(uint64_t));
+                if (super[i] >= 0 && cycleOf[i] != i)
+                {
+                        // numbered first, so its set is done
+                        memcpy(cls->interfaces, classes[super[i]]->interfaces,
+                                        words * sizeof(uint64_t));
+                }
+                else
+                {
+                        memset(cls->interfaces, 0, words * sizeof(uint64_t));
+                }
+                // The head of a cycle implements what the whole cycle does.
+                int k = i;
+                do
+                {
+                        classes[k]->AddInterfaces(cls->interfaces);
+                        k = super[k];
+                } while (cycleOf[i] == i && k != i);
+        }
+}
+
+void ClassDecl::AddInterfaces(uint64_t *set) const
+{
+        if (extends != nullptr)
+        {
+                const InterfaceDecl *iface = dyn_cast<InterfaceDecl>(
+                                parent->getVariable(extends->getTypeName()));
+                if (iface != nullptr)
+                {
+                        set[iface->index / 64] |= (uint64_t)1 << (iface->index % 64);
+                }
+        }
+        for (NamedType *type : *implements)
+        {
+                const Decl *named = parent->getVariable(type->getTypeName());
+                int bit = -1;
+                if (const InterfaceDecl *iface = dyn_cast<InterfaceDecl>(named))
+                {
+                        bit = iface->index;
+                }
+                else if (const ClassDecl *cls = dyn_cast<ClassDecl>(named))
+                {
+                        bit = cls->index;
+                }
+                if (bit >= 0)
+                {
+                        set[bit / 64] |= (uint64_t)1 << (bit % 64);
+                }
+        }
 }
 
 const Decl *ClassDecl::getMember(int i) const
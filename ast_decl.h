@@ -22,11 +22,13 @@ class Decl : public Node
     Identifier *id;
   
   public:
-    Decl(Identifier *name);
-    virtual void Check();
+    Decl(NodeKind kind, Identifier *name);
+    static bool classof(const Node *n)
+        { return n->GetKind() >= FirstDeclKind && n->GetKind() <= LastDeclKind; }
+    virtual void CheckStep(CheckWalk *walk, int step);
     virtual Type * getType() const = 0;
-    virtual const char *getName() const { return id->GetName(); }
-    virtual bool descendedFrom(const char *name) const;
+    virtual const char *getName() const { return id->GetName(); } // interned
+    virtual bool descendedFrom(const Decl *other) const;
 };
 
 class VarDecl : public Decl 
@@ -36,32 +38,62 @@ class VarDecl : public Decl
     
   public:
     VarDecl(Identifier *name, Type *type);
+    static bool classof(const Node *n) { return n->GetKind() == VarDeclKind; }
     const char *GetPrintNameForNode() { return "VarDecl"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     virtual Type* getType() const {return type;}
 
-    virtual const Decl *getVariable(const char *name) const;
+    virtual Search LookupHere(const char *name, const Decl **found) const;
 };
 
 class ClassDecl : public Decl 
 {
+    friend class AstImage;
   protected:
     List<Decl*> *members;
     NamedType *extends;
-    List<NamedType*> *implements;
+    List<NamedType*, 1> *implements;
+    Scope *scope;
+    const Scope *memberTable;  // see BuildMemberTables()
+    const ClassDecl *superclass;
+    int pre, low, post;        // see NumberClasses()
+    uint64_t *interfaces;      // a bit for each interface, by index
+    int index;                 // its bit, if an implements list names it
+    NamedType *type;           // the type of its objects, made by BuildScope
+
+    ClassDecl *Extended() const;
+    void MakeMemberTable();
+    const Decl *LookupMember(const char *name) const;
+    void AddInterfaces(uint64_t *set) const;
 
   public:
     ClassDecl(Identifier *name, NamedType *extends, 
-              List<NamedType*> *implements, List<Decl*> *members);
+              List<NamedType*, 1> *implements, List<Decl*> *members);
+    static bool classof(const Node *n) { return n->GetKind() == ClassDeclKind; }
     const char *GetPrintNameForNode() { return "ClassDecl"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
-    virtual Type *getType() const { return new Type(id->GetName()); }
-
-    virtual const Decl *getVariable(const char *name) const;
-    virtual const ClassDecl *getThis() const;
-    virtual bool descendedFrom(const char *name) const;
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+    virtual Type *getType() const { return type; }
+
+    // Makes the scope of what is declared here, inside outer (see
+    // scope.h). BuildScopes does this for the whole tree.
+    void BuildScope(const Scope *outer);
+    virtual const Scope *GetScope() const { return scope; }
+    virtual Search LookupHere(const char *name, const Decl **found) const;
+    virtual bool descendedFrom(const Decl *other) const;
+
+    // Makes the tables of every member the classes among decls have,
+    // their own and those they inherit, once the scopes of all the
+    // classes are made. Program::BuildScope does this.
+    static void BuildMemberTables(List<Decl*> *decls);
+
+    // Numbers the classes among decls, once their member tables are
+    // made, so that descendedFrom() need not search. Program::BuildScope
+    // does this.
+    static void NumberClasses(List<Decl*> *decls);
 
     const Decl *getMember(int i) const;
     int numMembers() const;
@@ -69,17 +101,26 @@ class ClassDecl : public Decl
 
 class InterfaceDecl : public Decl 
 {
+    friend class ClassDecl;
   protected:
     List<Decl*> *members;
+    Scope *scope;
+    int index;                 // among the program's interfaces
     
   public:
     InterfaceDecl(Identifier *name, List<Decl*> *members);
+    static bool classof(const Node *n) { return n->GetKind() == InterfaceDeclKind; }
     const char *GetPrintNameForNode() { return "InterfaceDecl"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     virtual Type *getType() const { return nullptr; }
 
-    virtual const Decl *getVariable(const char *name) const;
+    // Makes the scope of what is declared here, inside outer (see
+    // scope.h). BuildScopes does this for the whole tree.
+    void BuildScope(const Scope *outer);
+    virtual const Scope *GetScope() const { return scope; }
+    virtual Search LookupHere(const char *name, const Decl **found) const;
 
     const Decl *getMember(int i) const;
     int numMembers() const;
@@ -87,17 +128,22 @@ class InterfaceDecl : public Decl
 
 class FnDecl : public Decl 
 {
+    friend class AstImage;
   protected:
-    List<VarDecl*> *formals;
+    List<VarDecl*, 2> *formals;
     Type *returnType;
     Stmt *body;
+    Scope *scope;
+    const char *signature;     // interned, see signatureEqual()
     
   public:
-    FnDecl(Identifier *name, Type *returnType, List<VarDecl*> *formals);
+    FnDecl(Identifier *name, Type *returnType, List<VarDecl*, 2> *formals);
+    static bool classof(const Node *n) { return n->GetKind() == FnDeclKind; }
     void SetFunctionBody(Stmt *b);
     const char *GetPrintNameForNode() { return "FnDecl"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     virtual Type* getType() const {return returnType;}
     bool isFn() {return true;}
 
@@ -105,10 +151,16 @@ class FnDecl : public Decl
     const Type *formalType(int i) const;
     int NumFormals() const;
 
-    virtual const Decl *getVariable(const char *name) const;
-    virtual const ClassDecl *getThis() const;
+    // Makes the scope of what is declared here, inside outer (see
+    // scope.h). BuildScopes does this for the whole tree.
+    void BuildScope(const Scope *outer);
+    virtual const Scope *GetScope() const { return scope; }
+    virtual Search LookupHere(const char *name, const Decl **found) const;
 
-    bool signatureEqual(const FnDecl *other) const;
+    // Whether the two have the same return and formal types. Each
+    // function spells its signature out once, when it is made, and
+    // interns it, so this compares two pointers.
+    bool signatureEqual(const FnDecl *other) const { return signature == other->signature; }
 };
 
 #endif
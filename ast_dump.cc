@@ -0,0 +1,510 @@
+/* File: ast_dump.cc
+ * -----------------
+ * Implementation of DumpTree(): a Visitor that writes each node as it
+ * enters it into an output buffer.
+ */
+
+#include "ast_dump.h"
+#include "ast_visitor.h"
+#include "compilation.h"
+#include "symbols.h"
+#include "utility.h"
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+static const char *const kindNames[] = {
+#define KIND_NAME(C) #C,
+    AST_NODE_CLASSES(KIND_NAME)
+#undef KIND_NAME
+};
+
+bool ParseDumpFormat(const char *name, DumpFormat *format)
+{
+    if (strcmp(name, "json") == 0)
+        *format = JsonDump;
+    else if (strcmp(name, "text") == 0)
+        *format = TextDump;
+    else
+        return false;
+    return true;
+}
+
+
+/* Class: OutputBuffer
+ * -------------------
+ * Text piling up to be written to a file descriptor. Each thread has
+ * one block of memory that all its dumps use in turn. It grows up to
+ * HighWater bytes, and from then on what is in it is written out each
+ * time it fills, so a dump of any size is written a few MB at a time.
+ * Put() makes room and copies; a string literal is copied at the
+ * length it is known to have.
+ */
+class OutputBuffer
+{
+  public:
+    OutputBuffer(int fd);
+    ~OutputBuffer();
+
+    void Put(char c) { Room(1); *next++ = c; }
+    void Put(const char *s, size_t n) { Room(n); memcpy(next, s, n); next += n; }
+    void PutString(const char *s) { Put(s, strlen(s)); }
+    template <size_t N> void Put(const char (&literal)[N]) { Put(literal, N - 1); }
+    void PutNumber(long n);
+    void PutDouble(double d);
+    void PutQuoted(const char *s, size_t n); // as a JSON string
+    void PutQuoted(const char *s) { PutQuoted(s, strlen(s)); }
+    void PutSpaces(size_t n);
+
+    // Writes out what is in the buffer. Returns false if that or an
+    // earlier write failed.
+    bool Flush();
+
+  private:
+    static const size_t HighWater = 4 << 20;
+
+    void Room(size_t n) { if ((size_t)(limit - next) < n) MakeRoom(n); }
+    void MakeRoom(size_t n);
+    void Grow(size_t n);
+
+    struct Block {
+        char *base;
+        size_t size;
+        ~Block() { free(base); }
+    };
+    static thread_local Block reused;
+    char *next, *limit;
+    int fd;
+    bool failed;
+};
+
+thread_local OutputBuffer::Block OutputBuffer::reused;
+
+OutputBuffer::OutputBuffer(int f) : fd(f), failed(false)
+{
+    if (reused.size == 0)
+        Grow(1 << 20);
+    next = reused.base;
+    limit = reused.base + reused.size;
+}
+
+/* A Put() bigger than HighWater grew the block past it; the thread
+ * doesn't keep one that big for its next dump.
+ */
+OutputBuffer::~OutputBuffer()
+{
+    if (reused.size > HighWater) {
+        free(reused.base);
+        reused.base = NULL;
+        reused.size = 0;
+    }
+}
+
+/* Grows the block while it is under HighWater, and otherwise writes out
+ * what is in it first, growing it only for a Put() that is bigger.
+ */
+void OutputBuffer::MakeRoom(size_t n)
+{
+    size_t used = next - reused.base;
+    if (used + n > HighWater && used > 0) {
+        Flush();
+        used = 0;
+    }
+    if (reused.size - used < n)
+        Grow(n);
+}
+
+/* Makes the block twice as big, up to HighWater, or big enough for n
+ * more. It is not cleared, and realloc() can often grow a big one
+ * without copying what is in it.
+ */
+void OutputBuffer::Grow(size_t n)
+{
+    size_t used = reused.size ? next - reused.base : 0;
+    size_t size = std::max(std::min(2 * reused.size, (size_t)HighWater),
+                           used + n);
+    char *base = (char *)realloc(reused.base, size);
+    if (!base)
+        Failure("Out of memory for a dump of %lu bytes", (unsigned long)size);
+    reused.base = base;
+    reused.size = size;
+    next = base + used;
+    limit = base + size;
+}
+
+void OutputBuffer::PutNumber(long n)
+{
+    char digits[24], *p = digits + sizeof(digits);
+    unsigned long u = n < 0 ? 0UL - n : n;
+    do {
+        *--p = '0' + u % 10;
+        u /= 10;
+    } while (u > 0);
+    if (n < 0)
+        *--p = '-';
+    Put(p, digits + sizeof(digits) - p);
+}
+
+void OutputBuffer::PutDouble(double d)
+{
+    char digits[32];
+    Put(digits, snprintf(digits, sizeof(digits), "%.17g", d));
+}
+
+void OutputBuffer::PutQuoted(const char *s, size_t n)
+{
+    static const char hex[] = "0123456789abcdef";
+    Put('"');
+    const char *plain = s;
+    for (const char *end = s + n; s < end; s++) {
+        unsigned char c = *s;
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        Put(plain, s - plain);
+        plain = s + 1;
+        Put('\\');
+        switch (c) {
+          case '"': Put('"'); break;
+          case '\\': Put('\\'); break;
+          case '\n': Put('n'); break;
+          case '\t': Put('t'); break;
+          default:
+            Put("u00");
+            Put(hex[c >> 4]);
+            Put(hex[c & 15]);
+        }
+    }
+    Put(plain, s - plain);
+    Put('"');
+}
+
+void OutputBuffer::PutSpaces(size_t n)
+{
+    static const char spaces[] = "                                "
+                                 "                                ";
+    for (; n > sizeof(spaces) - 1; n -= sizeof(spaces) - 1)
+        Put(spaces);
+    Put(spaces, n);
+}
+
+/* After a write fails, the rest of the dump is thrown away. */
+bool OutputBuffer::Flush()
+{
+    const char *p = reused.base;
+    size_t left = next - p;
+    next = reused.base;
+    while (left > 0 && !failed) {
+        ssize_t written = write(fd, p, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            failed = true;
+        else {
+            p += written;
+            left -= written;
+        }
+    }
+    return !failed;
+}
+
+
+/* Class: LineCursor
+ * -----------------
+ * Finds the line and column of an offset as SourceLocation::Decode()
+ * does, but starting from the line it found last: a walk goes through
+ * the text in order, so that is nearly always the line wanted or the
+ * next one. On a line without tabs the column is just the distance from
+ * the start of the line.
+ */
+class LineCursor
+{
+  public:
+    LineCursor(SourceText *s) : source(s), starts(s->LineStarts()), line(0)
+        { Move(0); }
+    void Find(size_t offset, int *lineNumber, int *column);
+
+  private:
+    void Move(size_t index);
+
+    SourceText *source;
+    const std::vector<unsigned int> &starts;
+    size_t line;               // index in starts
+    size_t start, end;         // of the line
+    bool hasTab;
+};
+
+void LineCursor::Move(size_t index)
+{
+    line = index;
+    start = starts.empty() ? 0 : starts[line];
+    end = line + 1 < starts.size() ? starts[line + 1] : source->Length();
+    hasTab = end > start && memchr(source->Text() + start, '\t', end - start) != NULL;
+}
+
+void LineCursor::Find(size_t offset, int *lineNumber, int *column)
+{
+    bool last = (line + 1 >= starts.size());
+    if (offset < start || (offset >= end && !last)) {
+        if (offset >= end && line + 2 < starts.size() && offset < starts[line + 2])
+            Move(line + 1);
+        else
+            Move(source->LineOf(offset) - 1);
+    }
+    *lineNumber = line + 1;
+    *column = hasTab ? source->ColumnOf(offset)
+                     : 1 + std::min(offset, source->Length()) - start;
+}
+
+
+/* Class: TreeDumper
+ * -----------------
+ * Writes a node when the walk enters it. For JSON, open says of each
+ * node the walk is inside whether its "children" array has been
+ * started, which is done when its first child is entered.
+ */
+class TreeDumper : public Visitor<TreeDumper>
+{
+  public:
+    TreeDumper(DumpFormat f, bool a, SourceText *source, int fd)
+      : format(f), annotated(a), out(fd), from(source), to(source) {}
+    void Enter(Node *node);
+    void Leave(Node *node);
+    void EndLine() { out.Put('\n'); }
+    bool Finish() { return out.Flush(); }
+
+  private:
+    void PutSpan(SourceLocation loc);
+    void PutValue(Node *node);
+    void PutDecl(const Decl *decl);
+    const Decl *BoundDecl(Node *node, bool *isUse);
+
+    DumpFormat format;
+    bool annotated;
+    OutputBuffer out;
+    std::vector<char> open;
+    LineCursor from, to;       // for where spans start and end
+};
+
+void TreeDumper::Enter(Node *node)
+{
+    if (format == TextDump) {
+        out.PutSpaces(2 * open.size());
+        out.PutString(kindNames[node->GetKind()]);
+    } else {
+        if (!open.empty()) {
+            out.PutString(open.back() ? "," : ",\"children\":[");
+            open.back() = true;
+        }
+        out.Put("{\"kind\":\"");
+        out.PutString(kindNames[node->GetKind()]);
+        out.Put('"');
+    }
+    open.push_back(false);
+
+    if (node->GetLocation())
+        PutSpan(node->GetLocation());
+    PutValue(node);
+
+    if (annotated) {
+        Expr *expr = dyn_cast<Expr>(node);
+        Type *type = expr ? expr->KnownType() : NULL;
+        if (type) {
+            if (format == TextDump) {
+                out.Put(" : ");
+                out.PutString(type->getTypeName());
+            } else {
+                out.Put(",\"type\":");
+                out.PutQuoted(type->getTypeName());
+            }
+        }
+        bool isUse;
+        const Decl *decl = BoundDecl(node, &isUse);
+        if (isUse)
+            PutDecl(decl);
+    }
+    if (format == TextDump)
+        out.Put('\n');
+}
+
+void TreeDumper::Leave(Node *node)
+{
+    if (format == JsonDump)
+        out.PutString(open.back() ? "]}" : "}");
+    open.pop_back();
+}
+
+void TreeDumper::PutSpan(SourceLocation loc)
+{
+    yyltype at;
+    from.Find(loc.Offset(), &at.first_line, &at.first_column);
+    if (loc.Length() > 0) {
+        to.Find(loc.Offset() + loc.Length() - 1, &at.last_line, &at.last_column);
+    } else {
+        at.last_line = at.first_line;
+        at.last_column = at.first_column - 1;
+    }
+    if (format == TextDump) {
+        out.Put(' ');
+        out.PutNumber(at.first_line);
+        out.Put(':');
+        out.PutNumber(at.first_column);
+        out.Put('-');
+        out.PutNumber(at.last_line);
+        out.Put(':');
+        out.PutNumber(at.last_column);
+        out.Put(" @");
+        out.PutNumber(loc.Offset());
+        out.Put('+');
+        out.PutNumber(loc.Length());
+        return;
+    }
+    out.Put(",\"span\":{\"offset\":");
+    out.PutNumber(loc.Offset());
+    out.Put(",\"length\":");
+    out.PutNumber(loc.Length());
+    out.Put(",\"from\":[");
+    out.PutNumber(at.first_line);
+    out.Put(',');
+    out.PutNumber(at.first_column);
+    out.Put("],\"to\":[");
+    out.PutNumber(at.last_line);
+    out.Put(',');
+    out.PutNumber(at.last_column);
+    out.Put("]}");
+}
+
+/* The part of a node that is not a child. A string constant is given as
+ * written in text, and without its quotes in JSON. A double that JSON
+ * cannot hold (one too big for a double) is null there.
+ */
+void TreeDumper::PutValue(Node *node)
+{
+    bool text = (format == TextDump);
+    const char *name = NULL;
+    switch (node->GetKind()) {
+      case IdentifierKind:
+        name = cast<Identifier>(node)->GetName();
+        break;
+      case TypeKind:
+        name = cast<Type>(node)->getTypeName();
+        break;
+      case IntConstantKind:
+        out.PutString(text ? " " : ",\"value\":");
+        out.PutNumber(static_cast<IntConstant *>(node)->GetValue());
+        return;
+      case DoubleConstantKind: {
+        double value = static_cast<DoubleConstant *>(node)->GetValue();
+        out.PutString(text ? " " : ",\"value\":");
+        if (text || isfinite(value))
+            out.PutDouble(value);
+        else
+            out.Put("null");
+        return;
+      }
+      case BoolConstantKind:
+        out.PutString(text ? " " : ",\"value\":");
+        out.PutString(static_cast<BoolConstant *>(node)->GetValue() ? "true" : "false");
+        return;
+      case StringConstantKind: {
+        const char *value = static_cast<StringConstant *>(node)->GetValue();
+        if (text) {
+            out.Put(' ');
+            out.PutString(value);
+        } else {
+            out.Put(",\"value\":");
+            out.PutQuoted(value + 1, strlen(value) - 2);
+        }
+        return;
+      }
+      case PostfixExprKind:
+        name = OpToken(static_cast<PostfixExpr *>(node)->GetOp());
+        break;
+      default:
+        if (node->GetKind() >= FirstCompoundExprKind &&
+            node->GetKind() <= LastCompoundExprKind)
+            name = OpToken(static_cast<CompoundExpr *>(node)->GetOp());
+        break;
+    }
+    if (!name)
+        return;
+    if (text) {
+        out.Put(' ');
+        out.PutString(name);
+    } else {
+        bool isOp = isa<Expr>(node);
+        out.PutString(isOp ? ",\"op\":" : ",\"name\":");
+        out.PutQuoted(name);
+    }
+}
+
+/* The declaration that a use of a name stands for, found the way the
+ * checks find it; NULL if there is none. *isUse says whether the node
+ * is a use of a name at all.
+ */
+const Decl *TreeDumper::BoundDecl(Node *node, bool *isUse)
+{
+    *isUse = true;
+    switch (node->GetKind()) {
+      // Both are looked up once and kept in the annotations; a tree
+      // loaded from an image comes without them, so then it is here.
+      case FieldAccessKind:
+        return cast<FieldAccess>(node)->findField();
+      case CallKind:
+        return cast<Call>(node)->findFn();
+      case NamedTypeKind: {
+        const char *name = cast<NamedType>(node)->getTypeName();
+        SymbolTables &symbols = CurrentSymbols();
+        if (ClassDecl *cls = symbols.declared_classes.Lookup(name))
+            return cls;
+        return symbols.declared_interfaces.Lookup(name);
+      }
+      default:
+        *isUse = false;
+        return NULL;
+    }
+}
+
+void TreeDumper::PutDecl(const Decl *decl)
+{
+    yyltype at;
+    if (decl)
+        at = decl->GetLocation().Decode();
+    if (format == TextDump) {
+        out.Put(" -> ");
+        if (!decl) {
+            out.Put('?');
+            return;
+        }
+        out.PutString(kindNames[decl->GetKind()]);
+        out.Put(' ');
+        out.PutNumber(at.first_line);
+        out.Put(':');
+        out.PutNumber(at.first_column);
+        return;
+    }
+    if (!decl) {
+        out.Put(",\"decl\":null");
+        return;
+    }
+    out.Put(",\"decl\":{\"kind\":\"");
+    out.PutString(kindNames[decl->GetKind()]);
+    out.Put("\",\"at\":[");
+    out.PutNumber(at.first_line);
+    out.Put(',');
+    out.PutNumber(at.first_column);
+    out.Put("]}");
+}
+
+bool DumpTree(Node *root, DumpFormat format, bool annotated, int fd)
+{
+    TreeDumper dumper(format, annotated, &Compilation::Current()->source, fd);
+    dumper.Walk(root);
+    if (format == JsonDump)
+        dumper.EndLine();
+    return dumper.Finish();
+}
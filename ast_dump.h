@@ -0,0 +1,48 @@
+/* File: ast_dump.h
+ * ----------------
+ * This file declares DumpTree(), which writes a tree in a form meant for
+ * other tools to read rather than for people: dcc --dump-ast=json or
+ * --dump-ast=text. (Plain --dump-ast prints it with Print() as before.)
+ *
+ * Both forms give every node's kind (the name of its class), its span
+ * in the text, as offset and length and as the line and column where
+ * it starts and ends, and what the node holds that is not a child: a
+ * name, a constant's value, an operator. For a checked tree they also
+ * give the type of each expression and, for each use of a name (a
+ * FieldAccess, Call or NamedType), the declaration it stands for, known
+ * by its kind and where it starts. JSON nests the children of a node
+ * in its "children" array:
+ *
+ *     {"kind":"FieldAccess","span":{"offset":14,"length":1,"from":[2,9],
+ *      "to":[2,9]},"type":"int","decl":{"kind":"VarDecl","at":[1,5]},
+ *      "children":[{"kind":"Identifier","span":{...},"name":"x"}]}
+ *
+ * Text is one line per node, indented two spaces per level under the
+ * root:
+ *
+ *     FieldAccess 2:9-2:9 @14+1 : int -> VarDecl 1:5
+ *       Identifier 2:9-2:9 @14+1 x
+ *
+ * A use of a name that stands for nothing has "decl":null, or "-> ?".
+ * The tree is walked once (see ast_visitor.h) into a buffer that is
+ * written out whenever it holds a few MB, and at the end; the thread
+ * keeps it for its next dump.
+ */
+
+#ifndef _H_ast_dump
+#define _H_ast_dump
+
+class Node;
+
+enum DumpFormat { JsonDump, TextDump };
+
+// Sets *format to the one name names ("json" or "text"). Returns false
+// if it names neither.
+bool ParseDumpFormat(const char *name, DumpFormat *format);
+
+// Writes the tree under root to the file descriptor fd in the given
+// format; with annotated, the types and declarations too, which only a
+// checked tree has. Returns false if the write failed.
+bool DumpTree(Node *root, DumpFormat format, bool annotated, int fd);
+
+#endif
@@ -19,7 +19,7 @@ using namespace std;
         if ((left != nullptr && left->getType() == Type::errorType) || \
                         right->getType() == Type::errorType) \
         { \
-                type = Type::errorType; \
+                SetType(Type::errorType); \
                 return; \
         }
 
@@ -29,72 +29,80 @@ using namespace std;
                 assert(expr); \
         }
 
-IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
+IntConstant::IntConstant(yyltype loc, int val) : Expr(IntConstantKind, loc) {
     value = val;
-    type = Type::intType;
+    SetType(Type::intType);
 }
 void IntConstant::PrintChildren(int indentLevel) { 
-    printf("%d", value);
+    Printf("%d", value);
 }
 
-DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
+DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(DoubleConstantKind, loc) {
     value = val;
-    type = Type::doubleType;
+    SetType(Type::doubleType);
 }
 void DoubleConstant::PrintChildren(int indentLevel) { 
-    printf("%g", value);
+    Printf("%g", value);
 }
 
-BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
+BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(BoolConstantKind, loc) {
     value = val;
-    type = Type::boolType;
+    SetType(Type::boolType);
 }
 void BoolConstant::PrintChildren(int indentLevel) { 
-    printf("%s", value ? "true" : "false");
+    Printf("%s", value ? "true" : "false");
 }
 
-StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
+StringConstant::StringConstant(yyltype loc, const char *val) : Expr(StringConstantKind, loc) {
     Assert(val != NULL);
-    value = strdup(val);
-    type = Type::stringType;
+    value = val;
+    SetType(Type::stringType);
 }
 void StringConstant::PrintChildren(int indentLevel) { 
-    printf("%s",value);
-}
-
-Operator::Operator(yyltype loc, const char *tok) : Node(loc) {
-    Assert(tok != NULL);
-    strncpy(tokenString, tok, sizeof(tokenString));
+    Printf("%s",value);
 }
 
-void Operator::PrintChildren(int indentLevel) {
-    printf("%s",tokenString);
+const char *OpToken(Opcode op) {
+    static const char *const tokens[NumOpcodes] = {
+        "+", "-", "*", "/", "%",
+        "==", "!=", "<", ">", "<=", ">=",
+        "&&", "||", "!", "=", "++", "--"
+    };
+    Assert(op >= 0 && op < NumOpcodes);
+    return tokens[op];
 }
 
-CompoundExpr::CompoundExpr(Expr *l, Operator *o, Expr *r) 
-  : Expr(Join(l->GetLocation(), r->GetLocation())) {
-    Assert(l != NULL && o != NULL && r != NULL);
-    (op=o)->SetParent(this);
+CompoundExpr::CompoundExpr(NodeKind k, Expr *l, Opcode o, SourceLocation opLoc, Expr *r) 
+  : Expr(k, Join(l->GetLocation(), r->GetLocation())) {
+    Assert(l != NULL && r != NULL);
+    op = o;
+    opOffset = opLoc.Offset();
     (left=l)->SetParent(this); 
     (right=r)->SetParent(this);
 }
 
-CompoundExpr::CompoundExpr(Operator *o, Expr *r) 
-  : Expr(Join(o->GetLocation(), r->GetLocation())) {
-    Assert(o != NULL && r != NULL);
+CompoundExpr::CompoundExpr(NodeKind k, Opcode o, SourceLocation opLoc, Expr *r) 
+  : Expr(k, Join(opLoc, r->GetLocation())) {
+    Assert(r != NULL);
     left = NULL; 
-    (op=o)->SetParent(this);
+    op = o;
+    opOffset = opLoc.Offset();
     (right=r)->SetParent(this);
 }
 
 void CompoundExpr::PrintChildren(int indentLevel) {
    if (left) left->Print(indentLevel+1);
-   op->Print(indentLevel+1);
+   PrintLeaf(GetOpLocation(), indentLevel+1, "Operator", OpToken(GetOp()));
    right->Print(indentLevel+1);
 }
+
+void CompoundExpr::AppendChildren(std::vector<Node *> *children) {
+    if (left) children->push_back(left);
+    children->push_back(right);
+}
    
   
-ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
+ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(ArrayAccessKind, loc) {
     (base=b)->SetParent(this); 
     (subscript=s)->SetParent(this);
 }
@@ -103,13 +111,20 @@ void ArrayAccess::PrintChildren(int indentLevel) {
     base->Print(indentLevel+1);
     subscript->Print(indentLevel+1, "(subscript) ");
   }
+
+void ArrayAccess::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(base);
+    children->push_back(subscript);
+}
      
 FieldAccess::FieldAccess(Expr *b, Identifier *f) 
-  : LValue(b? Join(b->GetLocation(), f->GetLocation()) : *f->GetLocation()) {
+  : LValue(FieldAccessKind, b? Join(b->GetLocation(), f->GetLocation()) : f->GetLocation()) {
     Assert(f != NULL); // b can be be NULL (just means no explicit base)
     base = b; 
     if (base) base->SetParent(this); 
     (field=f)->SetParent(this);
+    scope = NULL;
+    enclosing = NULL;
 }
 
 
@@ -118,12 +133,18 @@ FieldAccess::FieldAccess(Expr *b, Identifier *f)
     field->Print(indentLevel+1);
   }
 
-Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
+void FieldAccess::AppendChildren(std::vector<Node *> *children) {
+    if (base) children->push_back(base);
+    children->push_back(field);
+}
+
+Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*, 2> *a) : Expr(CallKind, loc)  {
     Assert(f != NULL && a != NULL); // b can be be NULL (just means no explicit base)
     base = b;
     if (base) base->SetParent(this);
     (field=f)->SetParent(this);
     (actuals=a)->SetParentAll(this);
+    scope = NULL;
 }
 
  void Call::PrintChildren(int indentLevel) {
@@ -131,9 +152,15 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     field->Print(indentLevel+1);
     actuals->PrintAll(indentLevel+1, "(actuals) ");
   }
+
+void Call::AppendChildren(std::vector<Node *> *children) {
+    if (base) children->push_back(base);
+    children->push_back(field);
+    children->insert(children->end(), actuals->begin(), actuals->end());
+}
  
 
-NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) { 
+NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(NewExprKind, loc) { 
   Assert(c != NULL);
   (cType=c)->SetParent(this);
 }
@@ -142,12 +169,16 @@ void NewExpr::PrintChildren(int indentLevel) {
     cType->Print(indentLevel+1);
 }
 
-NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
+void NewExpr::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(cType);
+}
+
+NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(NewArrayExprKind, loc) {
     Assert(sz != NULL && et != NULL);
     (size=sz)->SetParent(this); 
     elemType = new ArrayType(loc, et);
     elemType->SetParent(this);
-    type = elemType;
+    SetType(elemType);
 }
 
 void NewArrayExpr::PrintChildren(int indentLevel) {
@@ -155,69 +186,149 @@ void NewArrayExpr::PrintChildren(int indentLevel) {
     elemType->Print(indentLevel+1);
 }
 
-PostfixExpr::PostfixExpr(LValue *lv, Operator *o) : Expr(Join(lv->GetLocation(), o->GetLocation())) {
-    Assert(lv != NULL && o != NULL);
+void NewArrayExpr::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(size);
+    children->push_back(elemType);
+}
+
+PostfixExpr::PostfixExpr(LValue *lv, Opcode o, SourceLocation opLoc) : Expr(PostfixExprKind, Join(lv->GetLocation(), opLoc)) {
+    Assert(lv != NULL);
     (lvalue=lv)->SetParent(this);
-    (op=o)->SetParent(this);
+    op = o;
+    opOffset = opLoc.Offset();
 }
 
 void PostfixExpr::PrintChildren(int indentLevel) {
     lvalue->Print(indentLevel+1);
-    op->Print(indentLevel+1);
+    PrintLeaf(GetOpLocation(), indentLevel+1, "Operator", OpToken(GetOp()));
+}
+
+void PostfixExpr::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(lvalue);
 }
 
-void DoubleConstant::Check() {
+void DoubleConstant::CheckStep(CheckWalk *walk, int step) {
 
 }
 
-void IntConstant::Check() {
+void IntConstant::CheckStep(CheckWalk *walk, int step) {
 
 }
 
-void BoolConstant::Check() {
+void BoolConstant::CheckStep(CheckWalk *walk, int step) {
 
 }
 
-void StringConstant::Check() {
+void StringConstant::CheckStep(CheckWalk *walk, int step) {
 
 }
 
-void CompoundExpr::Check() {
+void CompoundExpr::CheckStep(CheckWalk *walk, int step) {
         if (left != nullptr)
         {
-                left->Check();
+                if (step == 0)
+                {
+                        walk->Check(left);
+                        walk->Then(this, 1);
+                        return;
+                }
 
                 type_assert(left->getType());
         }
 
-        op->Check();
+        walk->Check(right);
+}
+
+/* Function: Expr::ComputeTypes()
+ * ------------------------------
+ * Works out the type of this expression along with the types it depends
+ * on that are not known yet, operands before the expressions using them.
+ * The pending expressions are kept on a stack of our own, so a chain
+ * like -(-(-(...))) or a + (b + (c + ...)) costs no C stack however
+ * long it is.
+ */
+Type *Expr::ComputeTypes()
+{
+        Expr *operands[2];
+        int n = TypeOperands(operands);
+        bool ready = true;
+        for (int i = 0; i < n; i++)
+        {
+                ready = ready && operands[i]->KnownType() != nullptr;
+        }
+        if (ready)
+        {
+                return ComputeType();
+        }
+
+        std::vector<std::pair<Expr*, bool> > stack; // true: operands done
+        stack.push_back(std::make_pair(this, false));
+        while (!stack.empty())
+        {
+                Expr *e = stack.back().first;
+                bool operandsDone = stack.back().second;
+                stack.pop_back();
+                if (e->KnownType() != nullptr)
+                {
+                        continue;
+                }
+                if (operandsDone)
+                {
+                        e->ComputeType();
+                        continue;
+                }
+                stack.push_back(std::make_pair(e, true));
+                n = e->TypeOperands(operands);
+                for (int i = 0; i < n; i++)
+                {
+                        stack.push_back(std::make_pair(operands[i], false));
+                }
+        }
+
+        return KnownType();
+}
 
-        right->Check();
+int ArithmeticExpr::TypeOperands(Expr *operands[2]) {
+        int n = 0;
+        if (left != nullptr)
+        {
+                operands[n++] = left;
+        }
+        operands[n++] = right;
+        return n;
 }
 
-Type *ArithmeticExpr::getType() {
-        if (type != nullptr)
+Type *ArithmeticExpr::ComputeType() {
+        if (KnownType() != nullptr)
         {
-                return type;
+                return KnownType();
         }
 
         if (left != nullptr && left->getType()->operator!=(right->getType()))
         {
-                type = Type::errorType;
+                SetType(Type::errorType);
         }
         else
         {
-                type = right->getType();
+                SetType(right->getType());
         }
 
-        return type;
+        return KnownType();
 }
 
-void ArithmeticExpr::Check() {
-        if (left != nullptr)
+void ArithmeticExpr::CheckStep(CheckWalk *walk, int step) {
+        switch (step)
         {
-                left->Check();
+        case 0:
+                if (left != nullptr)
+                {
+                        walk->Check(left);
+                        walk->Then(this, 1);
+                        return;
+                }
+                break;
 
+        case 1:
                 if (left->getType()->operator!=(right->getType()) ||
                                 (left->getType() != Type::intType &&
                                  left->getType() != Type::doubleType))
@@ -225,39 +336,48 @@ void ArithmeticExpr::Check() {
                         if (left->getType() != Type::errorType &&
                                         right->getType() != Type::errorType)
                         {
-                                ReportError::Formatted(op->GetLocation(),
+                                ReportError::Formatted(GetOpLocation(),
                                                 "Incompatible operands: %s %s %s",
                                                 left->getType()->getTypeName(),
-                                                op->getOp(),
+                                                OpToken(GetOp()),
                                                 right->getType()->getTypeName());
                         }
                         if (left->getType()->operator!=(right->getType()) &&
                                                 right->getType() == Type::stringType)
                         {
-                                ReportError::Formatted(op->GetLocation(),
+                                ReportError::Formatted(GetOpLocation(),
                                                 "Incompatible operands: %s %s %s",
                                                 left->getType()->getTypeName(),
-                                                op->getOp(),
+                                                OpToken(GetOp()),
                                                 right->getType()->getTypeName());
                         }
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
-        }
+                break;
 
-        right->Check();
-        if (type != Type::errorType && right->getType() != Type::intType &&
-                        right->getType() != Type::doubleType)
-        {
-                ReportError::Formatted(right->GetLocation(),
-                                "%s where int/double expected",
-                                right->getType()->getTypeName());
-                type = Type::errorType;
+        case 2:
+                if (KnownType() != Type::errorType && right->getType() != Type::intType &&
+                                right->getType() != Type::doubleType)
+                {
+                        ReportError::Formatted(right->GetLocation(),
+                                        "%s where int/double expected",
+                                        right->getType()->getTypeName());
+                        SetType(Type::errorType);
+                }
+                return;
         }
+
+        walk->Check(right);
+        walk->Then(this, 2);
 }
 
-void RelationalExpr::Check() {
-        left->Check();
-        op->Check();
+void RelationalExpr::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                walk->Check(left);
+                walk->Then(this, 1);
+                return;
+        }
 
         assert(left->getType());
         assert(right->getType());
@@ -268,71 +388,84 @@ void RelationalExpr::Check() {
         {
                 if (right->getType() != Type::errorType)
                 {
-                        ReportError::Formatted(op->GetLocation(),
+                        ReportError::Formatted(GetOpLocation(),
                                         "Incompatible operands: %s %s %s",
                                         left->getType()->getTypeName(),
-                                        op->getOp(),
+                                        OpToken(GetOp()),
                                         right->getType()->getTypeName());
                 }
         }
 
-        right->Check();
+        walk->Check(right);
 }
 
-void LogicalExpr::Check() {
+void LogicalExpr::CheckStep(CheckWalk *walk, int step) {
         //CompoundExpr::Check();
         //compound_expr_return_if_errors();
 
         if (left == nullptr)
         {
                 /* unary not */
-                if (strcmp(op->getOp(), "!") != 0)
+                if (GetOp() != NotOp)
                 {
                         ReportError::Formatted(location,
                                         "Weird unary error");
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                         return;
                 }
 
                 if (right->getType() != Type::boolType)
                 {
-                        ReportError::Formatted(op->GetLocation(),
+                        ReportError::Formatted(GetOpLocation(),
                                         "Incompatible operand: ! %s",
                                         right->getType()->getTypeName());
-                        type = Type::boolType;
+                        SetType(Type::boolType);
                 }
                 else
                 {
-                        right->Check();
+                        walk->Check(right);
                 }
         }
+        else if (step == 0)
+        {
+                walk->Check(left);
+                walk->Then(this, 1);
+        }
         else
         {
-                left->Check();
                 if (left->getType()->operator!=(right->getType()))
                 {
-                        ReportError::Formatted(op->GetLocation(),
+                        ReportError::Formatted(GetOpLocation(),
                                         "Incompatible operands: %s %s %s",
                                         left->getType()->getTypeName(),
-                                        op->getOp(),
+                                        OpToken(GetOp()),
                                         right->getType()->getTypeName());
                 }
                 else if (right->getType() != Type::boolType)
                 {
-                        ReportError::Formatted(op->GetLocation(),
+                        ReportError::Formatted(GetOpLocation(),
                                         "Incompatible operands: %s %s %s",
                                         left->getType()->getTypeName(),
-                                        op->getOp(),
+                                        OpToken(GetOp()),
                                         right->getType()->getTypeName());
                         //type = Type::errorType;
                         return;
                 }
-                right->Check();
+                walk->Check(right);
         }
 }
 
-void EqualityExpr::Check() {
-        CompoundExpr::Check();
+void EqualityExpr::CheckStep(CheckWalk *walk, int step) {
+        if (step < 2)
+        {
+                /* CompoundExpr's checks (steps 0 and 1), then ours */
+                CompoundExpr::CheckStep(walk, step);
+                if (step == 1)
+                {
+                        walk->Then(this, 2);
+                }
+                return;
+        }
 
         compound_expr_return_if_errors();
 
@@ -340,154 +473,195 @@ void EqualityExpr::Check() {
         {
                 if (left->getType()->isBasicType() || right->getType() != Type::nullType)
                 {
-                        ReportError::Formatted(op->GetLocation(),
+                        ReportError::Formatted(GetOpLocation(),
                                         "Incompatible operands: %s %s %s",
                                         left->getType()->getTypeName(),
-                                        op->getOp(),
+                                        OpToken(GetOp()),
                                         right->getType()->getTypeName());
                         //type = Type::errorType;
                         return;
                 }
         }
 
-        type = Type::boolType;
+        SetType(Type::boolType);
 }
 
-Type *FieldAccess::getType() {
-        if (type != nullptr)
+int FieldAccess::TypeOperands(Expr *operands[2]) {
+        if (base == nullptr)
         {
-                return type;
+                return 0;
         }
+        operands[0] = base;
+        return 1;
+}
 
-        if (base != nullptr)
+Type *FieldAccess::ComputeType() {
+        if (KnownType() != nullptr)
         {
-                const Decl *cls = parent->getVariable(base->getType()->getTypeName());
-                const Decl *var = nullptr;
+                return KnownType();
+        }
 
-                if (cls != nullptr)
-                {
-                        var = cls->getVariable(field->GetName());
-                }
-                else
-                {
-                        var = getVariable(field->GetName());
-                }
+        if (base != nullptr)
+        {
+                const Decl *var = findField();
 
-                if (var == nullptr)
+                if (var == nullptr || base->getType() == Type::errorType)
                 {
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
-                else if(getThis() == nullptr &&
-                                dynamic_cast<const VarDecl*>(var) != nullptr)
+                else if(enclosing == nullptr &&
+                                isa<VarDecl>(var))
                 {
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
                 else
                 {
-                        type = var->getType();
+                        SetType(var->getType());
                 }
         }
         else
         {
-                const VarDecl *var = dynamic_cast<const VarDecl*>(getVariable(field->GetName()));
+                const VarDecl *var = dyn_cast<VarDecl>(findField());
 
                 if(var == nullptr)
                 {
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
                 else
                 {
-                        type = var->getType();
+                        SetType(var->getType());
                 }
         }
 
-        assert(type);
-        return type;
+        assert(KnownType());
+        return KnownType();
 }
 
-void FieldAccess::Check() {
-        if (base != nullptr)
+/* The variable or method named, or NULL if there is none: a member of
+ * the base's class if it has one, else whatever the name is in scope.
+ * It is looked up once, by BindNames if there is no base and otherwise
+ * once the base's type is known, and read from the annotations after.
+ */
+const Decl *FieldAccess::findField() const
+{
+        Annotations &notes = Annotations::Current();
+        if (notes.IsBound(id))
         {
-                /* this is the classname.functionname variant */
-                base->Check();
-                field->Check();
+                return notes.DeclOf(id);
+        }
 
-                const Decl *cls = parent->getVariable(base->getType()->getTypeName());
-                const Decl *var = nullptr;
+        const Decl *found = nullptr;
+        const Decl *cls = nullptr;
+        if (base != nullptr)
+        {
+                cls = getVariable(scope, base->getType()->getTypeName());
+        }
+        if (cls != nullptr)
+        {
+                found = cls->getVariable(field->GetName());
+        }
+        else
+        {
+                found = getVariable(scope, field->GetName());
+        }
+        notes.SetDecl(id, found);
+        return found;
+}
 
-                if (cls != nullptr)
+void FieldAccess::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                if (base != nullptr)
                 {
-                        var = cls->getVariable(field->GetName());
+                        walk->Check(base);
                 }
-                else
+                walk->Check(field);
+                walk->Then(this, 1);
+                return;
+        }
+
+        if (base != nullptr)
+        {
+                /* this is the classname.functionname variant */
+                const Decl *var = findField();
+
+                if (base->getType() == Type::errorType)
                 {
-                        var = getVariable(field->GetName());
+                        /* the base has been reported already */
+                        SetType(Type::errorType);
                 }
-
-                if (var == nullptr && base->getType() != Type::errorType)
+                else if (var == nullptr)
                 {
                         ReportError::Formatted(field->GetLocation(),
                                         "%s has no such field '%s'",
                                         base->getType()->getTypeName(),
                                         field->GetName());
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
-                else if(getThis() == nullptr &&
-                                dynamic_cast<const VarDecl*>(var) != nullptr)
+                else if(enclosing == nullptr &&
+                                isa<VarDecl>(var))
                 {
                         ReportError::Formatted(field->GetLocation(),
                                         "%s field '%s' only accessible within class scope",
-                                        cls->getName(),
+                                        base->getType()->getTypeName(),
                                         var->getName());
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
                 else
                 {
-                        type = var->getType();
+                        SetType(var->getType());
                 }
         }
         else
         {
                 /* this is the case where it's varname op */
-                const VarDecl *var = dynamic_cast<const VarDecl*>(getVariable(field->GetName()));
-
-                field->Check();
+                const VarDecl *var = dyn_cast<VarDecl>(findField());
 
                 if(var == nullptr)
                 {
                         ReportError::Formatted(location,
                                         "No declaration found for variable '%s'",
                                         field->GetName());
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
                 else
                 {
-                        type = var->getType();
+                        SetType(var->getType());
                 }
         }
 }
 
-Type *ArrayAccess::getType() {
-        if (type != nullptr)
+int ArrayAccess::TypeOperands(Expr *operands[2]) {
+        operands[0] = base;
+        return 1;
+}
+
+Type *ArrayAccess::ComputeType() {
+        if (KnownType() != nullptr)
         {
-                return type;
+                return KnownType();
         }
 
-        const ArrayType *t = dynamic_cast<const ArrayType*>(base->getType());
+        const ArrayType *t = dyn_cast<ArrayType>(base->getType());
         if (t == nullptr)
         {
-                type = Type::errorType;
+                SetType(Type::errorType);
         }
         else
         {
-                type = t->getBaseType();
+                SetType(t->getBaseType());
         }
 
-        return type;
+        return KnownType();
 }
 
-void ArrayAccess::Check() {
-        subscript->Check();
+void ArrayAccess::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                walk->Check(subscript);
+                walk->Then(this, 1);
+                return;
+        }
 
         if (subscript->getType() != Type::intType)
         {
@@ -496,102 +670,128 @@ void ArrayAccess::Check() {
                                 subscript->getType()->getTypeName());
         }
 
-        const ArrayType *t = dynamic_cast<const ArrayType*>(base->getType());
+        const ArrayType *t = dyn_cast<ArrayType>(base->getType());
         if (t == nullptr)
         {
-                if (dynamic_cast<ArrayAccess*>(base) != nullptr &&
+                if (isa<ArrayAccess>(base) &&
                                 base->getType() != Type::errorType)
                 {
                         ReportError::Formatted(base->GetLocation(),
                                         "[] can only be applied to arrays");
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
-                else if (dynamic_cast<ArrayAccess*>(base) == nullptr)
+                else if (!isa<ArrayAccess>(base))
                 {
                         ReportError::Formatted(base->GetLocation(),
                                         "[] can only be applied to arrays");
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
         }
         else
         {
-                type = t->getBaseType();
+                SetType(t->getBaseType());
         }
 
-        base->Check();
+        walk->Check(base);
 }
 
-void Operator::Check() {
-        /* char tokenString[4] */
-        /* TODO Check tokenString is actually an operator ? */
+int Call::TypeOperands(Expr *operands[2]) {
+        if (base == nullptr)
+        {
+                return 0;
+        }
+        operands[0] = base;
+        return 1;
 }
 
-Type *Call::getType() {
-        if (type != nullptr)
+Type *Call::ComputeType() {
+        if (KnownType() != nullptr)
         {
-                return type;
+                return KnownType();
         }
 
-        const FnDecl *fn = nullptr;
-
-        if (base != nullptr)
+        const FnDecl *fn = findFn();
+        if (fn == nullptr)
         {
-                const Decl *cls = parent->getVariable(base->getType()->getTypeName());
-                if (cls == nullptr)
-                {
-                        type = Type::errorType;
-                }
-                else
-                {
-                        fn = dynamic_cast<const FnDecl*>(cls->getVariable(field->GetName()));
-                        if (fn == nullptr)
-                        {
-                                type = Type::errorType;
-                        }
-                        else
-                        {
-                                type = fn->getType();
-                        }
-                }
+                SetType(Type::errorType);
         }
         else
         {
-                fn = dynamic_cast<const FnDecl*>(parent->getVariable(field->GetName()));
-                if (fn == nullptr)
-                {
-                        type = Type::errorType;
-                }
-                else
-                {
-                        type = fn->getType();
-                }
+                SetType(fn->getType());
         }
 
-        if (fn == nullptr)
+        return KnownType();
+}
+
+/* The function called, or NULL if there is no such function. Like a
+ * field, it is looked up once and read from the annotations after.
+ */
+const FnDecl *Call::findFn() const
+{
+        Annotations &notes = Annotations::Current();
+        if (notes.IsBound(id))
         {
-                type = Type::errorType;
+                return static_cast<const FnDecl *>(notes.DeclOf(id));
         }
 
-        return type;
+        const FnDecl *fn = nullptr;
+        if (base == nullptr)
+        {
+                fn = dyn_cast<FnDecl>(getVariable(scope, field->GetName()));
+        }
+        else
+        {
+                const Decl *cls = getVariable(scope, base->getType()->getTypeName());
+                if (cls != nullptr)
+                {
+                        fn = dyn_cast<FnDecl>(cls->getVariable(field->GetName()));
+                }
+        }
+        notes.SetDecl(id, fn);
+        return fn;
 }
 
-void Call::Check() {
+void Call::CheckStep(CheckWalk *walk, int step) {
         int i = 0;
         const FnDecl *fn = nullptr;
 
-        if (base != nullptr)
+        switch (step)
         {
-                base->Check();
+        case 0:
+                if (base != nullptr)
+                {
+                        walk->Check(base);
+                        walk->Then(this, 1);
+                        return;
+                }
 
+                fn = findFn();
+                if (fn == nullptr)
+                {
+                        ReportError::Formatted(field->GetLocation(),
+                                        "No declaration found for function '%s'",
+                                        field->GetName());
+                        SetType(Type::errorType);
+                        return;
+                }
+                else
+                {
+                        SetType(fn->getType());
+                }
+                break;
+
+        case 1:
                 if (base->getType() == nullptr ||
                                 base->getType() == Type::errorType)
                 {
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                         return;
                 }
 
-                const Decl *cls = parent->getVariable(base->getType()->getTypeName());
-                if (cls == nullptr)
+                fn = findFn();
+                /* no class to look in at all */
+                if (fn == nullptr &&
+                                getVariable(scope, base->getType()->getTypeName()) == nullptr)
                 {
                         const Type *t = base->getType();
                         assert(t);
@@ -605,7 +805,7 @@ void Call::Check() {
                                                 t->getTypeName(),
                                                 field->GetName());
                         }
-                        else if (dynamic_cast<const ArrayType*>(t) != nullptr &&
+                        else if (isa<ArrayType>(t) &&
                                         strcmp(field->GetName(), "length") != 0)
                         {
                                 ReportError::Formatted(field->GetLocation(),
@@ -613,154 +813,153 @@ void Call::Check() {
                                                 t->getTypeName(),
                                                 field->GetName());
                         }
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                         return;
                 }
 
-                field->Check();
-
-                fn = dynamic_cast<const FnDecl*>(cls->getVariable(field->GetName()));
+                walk->Check(field);
                 if (fn == nullptr)
                 {
                         ReportError::Formatted(field->GetLocation(),
                                         "%s has no such field '%s'",
                                         base->getType()->getTypeName(),
                                         field->GetName());
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                 }
                 else
                 {
-                        type = fn->getType();
+                        SetType(fn->getType());
                 }
-        }
-        else
-        {
-                fn = dynamic_cast<const FnDecl*>(parent->getVariable(field->GetName()));
+                break;
+
+        case 2:
+                /* the actuals have been checked */
+                fn = findFn();
                 if (fn == nullptr)
                 {
-                        ReportError::Formatted(field->GetLocation(),
-                                        "No declaration found for function '%s'",
-                                        field->GetName());
-                        type = Type::errorType;
+                        SetType(Type::errorType);
                         return;
                 }
-                else
-                {
-                        type = fn->getType();
-                }
-        }
-
-        for (i = 0; i < actuals->NumElements(); i++)
-        {
-                actuals->Nth(i)->Check();
-        }
-
-        if (fn == nullptr)
-        {
-                type = Type::errorType;
-                return;
-        }
-
-        if (actuals->NumElements() != fn->NumFormals())
-        {
-                ReportError::Formatted(field->GetLocation(),
-                                "Function '%s' expects %d arguments but %d given",
-                                field->GetName(),
-                                fn->NumFormals(),
-                                actuals->NumElements());
-                type = Type::errorType;
-        }
 
-        for (i = 0; i < actuals->NumElements() && i < fn->NumFormals(); i++)
-        {
-                const Type *actualType = actuals->Nth(i)->getType();
-                if (actualType == Type::errorType)
+                if (actuals->NumElements() != fn->NumFormals())
                 {
-                        continue;
+                        ReportError::Formatted(field->GetLocation(),
+                                        "Function '%s' expects %d arguments but %d given",
+                                        field->GetName(),
+                                        fn->NumFormals(),
+                                        actuals->NumElements());
+                        SetType(Type::errorType);
                 }
 
-                if(!fn->formalType(i)->isBasicType() && actualType == Type::nullType)
+                for (Expr *actual : *actuals)
                 {
-                        continue;
-                }
+                        if (i == fn->NumFormals())
+                        {
+                                break;
+                        }
+                        const Type *formalType = fn->formalType(i++);
+                        const Type *actualType = actual->getType();
+                        if (actualType == Type::errorType)
+                        {
+                                continue;
+                        }
 
-                if (actualType->operator!=(fn->formalType(i)))
-                {
-                        ReportError::Formatted(actuals->Nth(i)->GetLocation(),
-                                        "Incompatible argument %d: %s given, %s expected",
-                                        i + 1,
-                                        actuals->Nth(i)->getType()->getTypeName(),
-                                        fn->formalType(i)->getTypeName());
-                        type = Type::errorType;
+                        if(!formalType->isBasicType() && actualType == Type::nullType)
+                        {
+                                continue;
+                        }
+
+                        if (actualType->operator!=(formalType))
+                        {
+                                ReportError::Formatted(actual->GetLocation(),
+                                                "Incompatible argument %d: %s given, %s expected",
+                                                i,
+                                                actualType->getTypeName(),
+                                                formalType->getTypeName());
+                                SetType(Type::errorType);
+                        }
                 }
+                return;
         }
+
+        walk->CheckAll(actuals);
+        walk->Then(this, 2);
 }
 
-void NewArrayExpr::Check() {
-        size->Check();
+void NewArrayExpr::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                walk->Check(size);
+                walk->Then(this, 1);
+                return;
+        }
 
         if(size->getType()->operator!=(Type::intType))
         {
             ReportError::Formatted(size->GetLocation(),
                                         "Size for NewArray must be an integer");
-            type = Type::errorType;
+            SetType(Type::errorType);
         }
 
-        elemType->Check();
-        const ArrayType *t = dynamic_cast<const ArrayType*>(elemType);
+        walk->Check(elemType);
+        const ArrayType *t = dyn_cast<ArrayType>(elemType);
         assert(t);
         const Type *bt = t->getBaseType();
 
-        type = elemType;
+        SetType(elemType);
 }
 
-void NewExpr::Check() {
-        const ClassDecl *cls = dynamic_cast<const ClassDecl*>(
-                        parent->getVariable(cType->getTypeName()));
+void NewExpr::CheckStep(CheckWalk *walk, int step) {
+        const ClassDecl *cls = dyn_cast<ClassDecl>(cType->GetDecl());
         if (cls == nullptr)
         {
                 ReportError::Formatted(cType->GetLocation(),
                                 "No declaration found for class '%s'",
                                 cType->getTypeName());
-                type = Type::errorType;
+                SetType(Type::errorType);
         }
         else
         {
-                cType->Check();
-                type = cType;
+                walk->Check(cType);
+                SetType(cType);
         }
 }
 
-void PostfixExpr::Check() {
+void PostfixExpr::CheckStep(CheckWalk *walk, int step) {
         /* TODO Ensure that the op can be applied to the lvalue */
-        lvalue->Check();
-        op->Check();
+        walk->Check(lvalue);
 }
 
-void NullConstant::Check() {
-    type = Type::nullType;
+void NullConstant::CheckStep(CheckWalk *walk, int step) {
+    SetType(Type::nullType);
 }
 
-Type *This::getType()
+Type *This::ComputeType()
 {
-        if (type != nullptr)
+        if (KnownType() != nullptr)
         {
-                return type;
+                return KnownType();
         }
 
-        if (parent->getThis() == nullptr)
+        const ClassDecl *cls = dyn_cast<ClassDecl>(KnownDecl());
+        if (cls == nullptr)
         {
-                type = Type::errorType;
+                SetType(Type::errorType);
         }
         else
         {
-                type = parent->getThis()->getType();
+                SetType(cls->getType());
         }
 
-        return type;
+        return KnownType();
 }
 
-void This::Check() {
+void This::BindName(const ClassDecl *cls)
+{
+        SetDecl(cls);
+}
+
+void This::CheckStep(CheckWalk *walk, int step) {
         if (getType() == Type::errorType)
         {
                 ReportError::Formatted(location,
@@ -768,40 +967,44 @@ void This::Check() {
         }
 }
 
-void ReadIntegerExpr::Check() {
-        type = Type::intType;
+void ReadIntegerExpr::CheckStep(CheckWalk *walk, int step) {
+        SetType(Type::intType);
 }
 
-void ReadLineExpr::Check() {
-        type = Type::stringType;
+void ReadLineExpr::CheckStep(CheckWalk *walk, int step) {
+        SetType(Type::stringType);
 }
 
-void EmptyExpr::Check() {
-        type = nullptr;
+void EmptyExpr::CheckStep(CheckWalk *walk, int step) {
+        SetType(nullptr);
 }
 
-Type *NewExpr::getType() {
-        if (type != nullptr)
+Type *NewExpr::ComputeType() {
+        if (KnownType() != nullptr)
         {
-                return type;
+                return KnownType();
         }
 
-        const ClassDecl *cls = dynamic_cast<const ClassDecl*>(
-                        parent->getVariable(cType->getTypeName()));
+        const ClassDecl *cls = dyn_cast<ClassDecl>(cType->GetDecl());
         if (cls == nullptr)
         {
-                type = Type::errorType;
+                SetType(Type::errorType);
         }
         else
         {
-                type = cType;
+                SetType(cType);
         }
 
-        return type;
+        return KnownType();
 }
 
-void AssignExpr::Check() {
-        left->Check();
+void AssignExpr::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                walk->Check(left);
+                walk->Then(this, 1);
+                return;
+        }
 
         if(right->getType()->operator!=(left->getType()) &&
                         !right->getType()->isDescendedFrom(left->getType()))
@@ -810,7 +1013,7 @@ void AssignExpr::Check() {
                 {
                     if(left->getType()->isBasicType())
                     {
-                            ReportError::Formatted(op->GetLocation(),
+                            ReportError::Formatted(GetOpLocation(),
                                 "Incompatible operands: %s = %s",
                                 left->getType()->getTypeName(),
                                 right->getType()->getTypeName());
@@ -819,32 +1022,12 @@ void AssignExpr::Check() {
                 else if (right->getType() != Type::errorType &&
                                 left->getType() != Type::errorType)
                 {
-                    ReportError::Formatted(op->GetLocation(),
+                    ReportError::Formatted(GetOpLocation(),
                                 "Incompatible operands: %s = %s",
                                 left->getType()->getTypeName(),
                                 right->getType()->getTypeName());
                 }
         }
 
-        right->Check();
-}
-
-const Decl *CompoundExpr::getVariable(const char *name) const
-{
-        return parent->getVariable(name);
-}
-
-const Decl *FieldAccess::getVariable(const char *name) const
-{
-        return parent->getVariable(name);
-}
-
-const Decl *Call::getVariable(const char *name) const
-{
-        return parent->getVariable(name);
-}
-
-const ClassDecl *Expr::getThis() const
-{
-        return parent->getThis();
+        walk->Check(right);
 }
@@ -14,17 +14,44 @@
 #include "ast_stmt.h"
 #include "list.h"
 #include "ast_type.h"
+#include "annotations.h"
+#include <string.h>
 
+class FnDecl;
+
+// An expression's type, and what it names, are not kept in the node but
+// in the compilation's Annotations (see annotations.h), by the node's id.
 class Expr : public Stmt 
 {
   public:
-    Expr(yyltype loc) : Stmt(loc) {}
-    Expr() : Stmt() {}
-    Type *type;
-    virtual Type* getType() {return type;}
+    Expr(NodeKind kind, SourceLocation loc)
+      : Stmt(kind, loc), id(Annotations::Current().NewExpr()) {}
+    Expr(NodeKind kind) : Stmt(kind), id(Annotations::Current().NewExpr()) {}
+    static bool classof(const Node *n)
+        { return n->GetKind() >= FirstExprKind && n->GetKind() <= LastExprKind; }
+    uint32_t GetId() const { return id; }
+
+    // The type as far as it is known, NULL if it has not been worked out.
+    Type *KnownType() const { return Annotations::Current().TypeOf(id); }
+    void SetType(Type *t) { Annotations::Current().SetType(id, t); }
+    // Returns the type, working it out first if it isn't known yet.
+    Type *getType() { Type *t = KnownType(); return t ? t : ComputeTypes(); }
+    // What a FieldAccess, Call or This names, once it has been bound.
+    const Decl *KnownDecl() const { return Annotations::Current().DeclOf(id); }
 
-    virtual const ClassDecl *getThis() const;
     virtual bool isCall() {return false;}
+
+  protected:
+    const uint32_t id;
+    void SetDecl(const Decl *d) { Annotations::Current().SetDecl(id, d); }
+
+    // ComputeType() works out the type of an expression whose type is not
+    // known yet, from the types of the operands TypeOperands() lists.
+    // ComputeTypes() works those out first, deepest first, so that no
+    // ComputeType() has to recurse into a long chain of operands.
+    virtual Type *ComputeType() {return KnownType();}
+    virtual int TypeOperands(Expr *operands[2]) {return 0;}
+    Type *ComputeTypes();
 };
 
 /* This node type is used for those places where an expression is optional.
@@ -33,140 +60,162 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
+    EmptyExpr() : Expr(EmptyExprKind) {}
     const char *GetPrintNameForNode() { return "Empty"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class IntConstant : public Expr 
 {
+    friend class AstImage;
   protected:
     int value;
   
   public:
     IntConstant(yyltype loc, int val);
+    int GetValue() const { return value; }
     const char *GetPrintNameForNode() { return "IntConstant"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class DoubleConstant : public Expr 
 {
+    friend class AstImage;
   protected:
     double value;
     
   public:
     DoubleConstant(yyltype loc, double val);
+    double GetValue() const { return value; }
     const char *GetPrintNameForNode() { return "DoubleConstant"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class BoolConstant : public Expr 
 {
+    friend class AstImage;
   protected:
     bool value;
     
   public:
     BoolConstant(yyltype loc, bool val);
+    bool GetValue() const { return value; }
     const char *GetPrintNameForNode() { return "BoolConstant"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class StringConstant : public Expr 
 { 
+    friend class AstImage;
   protected:
-    char *value;
+    const char *value;
     
   public:
-    StringConstant(yyltype loc, const char *val);
+    StringConstant(yyltype loc, const char *val); // keeps val, which must last as long as the tree
+    const char *GetValue() const { return value; } // with its quotes
     const char *GetPrintNameForNode() { return "StringConstant"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class NullConstant: public Expr 
 {
   public: 
-    NullConstant(yyltype loc) : Expr(loc) {type = Type::nullType;}
+    NullConstant(yyltype loc) : Expr(NullConstantKind, loc) {SetType(Type::nullType);}
     const char *GetPrintNameForNode() { return "NullConstant"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
-class Operator : public Node 
-{
-  protected:
-    char tokenString[4];
-    
-  public:
-    Operator(yyltype loc, const char *tok);
-    const char *GetPrintNameForNode() { return "Operator"; }
-    void PrintChildren(int indentLevel);
-    virtual void Check();
-    char* getOp() {return tokenString;}
- };
- 
+/* Enum: Opcode
+ * ------------
+ * The operator of a CompoundExpr or PostfixExpr, which keeps it in the
+ * expression node along with where its token is, rather than in a node
+ * of its own. OpToken() gives the operator as written.
+ */
+enum Opcode {
+    PlusOp, MinusOp, TimesOp, DivideOp, ModOp,
+    EqualOp, NotEqualOp, LessOp, GreaterOp, LessEqualOp, GreaterEqualOp,
+    AndOp, OrOp, NotOp, AssignOp, IncrementOp, DecrementOp,
+    NumOpcodes
+};
+
+const char *OpToken(Opcode op);
+
 class CompoundExpr : public Expr
 {
+    friend class AstImage;
   protected:
-    Operator *op;
     Expr *left, *right; // left will be NULL if unary
+    uint32_t opOffset;  // of the operator's token in the text
+    unsigned char op;   // an Opcode
     
   public:
-    CompoundExpr(Expr *lhs, Operator *op, Expr *rhs); // for binary
-    CompoundExpr(Operator *op, Expr *rhs);             // for unary
+    CompoundExpr(NodeKind kind, Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs); // for binary
+    CompoundExpr(NodeKind kind, Opcode op, SourceLocation opLoc, Expr *rhs);             // for unary
     void PrintChildren(int indentLevel);
-    virtual void Check();
-    virtual const Decl *getVariable(const char *name) const;
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+
+    Opcode GetOp() const { return (Opcode)op; }
+    SourceLocation GetOpLocation() const
+        { return SourceLocation(opOffset, strlen(OpToken(GetOp()))); }
 };
 
 class ArithmeticExpr : public CompoundExpr 
 {
   public:
-    ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
+    ArithmeticExpr(Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(ArithmeticExprKind, lhs,op,opLoc,rhs) {}
+    ArithmeticExpr(Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(ArithmeticExprKind, op,opLoc,rhs) {}
     const char *GetPrintNameForNode() { return "ArithmeticExpr"; }
-    virtual void Check();
-    virtual Type* getType();
+    virtual void CheckStep(CheckWalk *walk, int step);
+
+  protected:
+    virtual Type *ComputeType();
+    virtual int TypeOperands(Expr *operands[2]);
 };
 
 class RelationalExpr : public CompoundExpr 
 {
   public:
-    RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {type = Type::boolType;}
+    RelationalExpr(Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(RelationalExprKind, lhs,op,opLoc,rhs) {SetType(Type::boolType);}
     const char *GetPrintNameForNode() { return "RelationalExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class EqualityExpr : public CompoundExpr 
 {
   public:
-    EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {type = Type::boolType;}
+    EqualityExpr(Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(EqualityExprKind, lhs,op,opLoc,rhs) {SetType(Type::boolType);}
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class LogicalExpr : public CompoundExpr 
 {
   public:
-    LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {type = Type::boolType;}
-    LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {type = Type::boolType;}
+    LogicalExpr(Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(LogicalExprKind, lhs,op,opLoc,rhs) {SetType(Type::boolType);}
+    LogicalExpr(Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(LogicalExprKind, op,opLoc,rhs) {SetType(Type::boolType);}
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class AssignExpr : public CompoundExpr 
 {
   public:
-    AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
+    AssignExpr(Expr *lhs, Opcode op, SourceLocation opLoc, Expr *rhs) : CompoundExpr(AssignExprKind, lhs,op,opLoc,rhs) {}
     const char *GetPrintNameForNode() { return "AssignExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class LValue : public Expr 
 {
   public:
-    LValue(yyltype loc) : Expr(loc) {}
+    LValue(NodeKind kind, SourceLocation loc) : Expr(kind, loc) {}
+    static bool classof(const Node *n)
+        { return n->GetKind() >= FirstLValueKind && n->GetKind() <= LastLValueKind; }
     //virtual void Check();
     //virtual Type* getType();
 };
@@ -174,10 +223,14 @@ class LValue : public Expr
 class This : public Expr 
 {
   public:
-    This(yyltype loc) : Expr(loc) {}
+    This(yyltype loc) : Expr(ThisKind, loc) {}
     const char *GetPrintNameForNode() { return "This"; }
-    virtual void Check();
-    virtual Type* getType();
+    virtual void CheckStep(CheckWalk *walk, int step);
+    // Records the class this is in (NULL outside of one).
+    void BindName(const ClassDecl *cls);
+
+  protected:
+    virtual Type *ComputeType();
 };
 
 class ArrayAccess : public LValue 
@@ -187,11 +240,16 @@ class ArrayAccess : public LValue
     
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
+    static bool classof(const Node *n) { return n->GetKind() == ArrayAccessKind; }
     const char *GetPrintNameForNode() { return "ArrayAccess"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
-    virtual Type* getType();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     Expr *getBase() { return base; }
+
+  protected:
+    virtual Type *ComputeType();
+    virtual int TypeOperands(Expr *operands[2]);
 };
 
 /* Note that field access is used both for qualified names
@@ -201,18 +259,29 @@ class ArrayAccess : public LValue
  * and sort it out later. */
 class FieldAccess : public LValue 
 {
+    friend class AstImage;
   protected:
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
+    const Scope *scope;         // the name is written in; see BindName()
+    const ClassDecl *enclosing; // the class it is in, or NULL
     
   public:
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
+    static bool classof(const Node *n) { return n->GetKind() == FieldAccessKind; }
     const char *GetPrintNameForNode() { return "FieldAccess"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+    const Decl *findField() const;
+    // Records where the access is, for the lookups, and looks the name
+    // up now if that doesn't need the base's type.
+    void BindName(const Scope *s, const ClassDecl *cls)
+        { scope = s; enclosing = cls; if (base == nullptr) findField(); }
 
-    virtual const Decl *getVariable(const char *name) const;
-    virtual Type* getType();
+  protected:
+    virtual Type *ComputeType();
+    virtual int TypeOperands(Expr *operands[2]);
 };
 
 /* Like field access, call is used both for qualified base.field()
@@ -221,19 +290,29 @@ class FieldAccess : public LValue
  * and sort it out later. */
 class Call : public Expr 
 {
+    friend class AstImage;
   protected:
     Expr *base;	// will be NULL if no explicit base
     Identifier *field;
-    List<Expr*> *actuals;
+    List<Expr*, 2> *actuals;
+    const Scope *scope; // the name is written in; see BindName()
     
   public:
-    Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
+    Call(yyltype loc, Expr *base, Identifier *field, List<Expr*, 2> *args);
+    static bool classof(const Node *n) { return n->GetKind() == CallKind; }
     const char *GetPrintNameForNode() { return "Call"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     bool isCall(){return true;}
-    virtual const Decl *getVariable(const char *name) const;
-    virtual Type *getType();
+    const FnDecl *findFn() const;
+    // Records where the call is, for the lookups, and looks the name up
+    // now if that doesn't need the base's type.
+    void BindName(const Scope *s) { scope = s; if (base == nullptr) findFn(); }
+
+  protected:
+    virtual Type *ComputeType();
+    virtual int TypeOperands(Expr *operands[2]);
 };
 
 class NewExpr : public Expr
@@ -245,49 +324,61 @@ class NewExpr : public Expr
     NewExpr(yyltype loc, NamedType *clsType);
     const char *GetPrintNameForNode() { return "NewExpr"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
-    virtual Type *getType();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+
+  protected:
+    virtual Type *ComputeType();
 };
 
 class NewArrayExpr : public Expr
 {
+    friend class AstImage;
   protected:
     Expr *size;
     Type *elemType;
 
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
+    static bool classof(const Node *n) { return n->GetKind() == NewArrayExprKind; }
     const char *GetPrintNameForNode() { return "NewArrayExpr"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class ReadIntegerExpr : public Expr
 {
   public:
-    ReadIntegerExpr(yyltype loc) : Expr(loc) {type = Type::intType;}
+    ReadIntegerExpr(yyltype loc) : Expr(ReadIntegerExprKind, loc) {SetType(Type::intType);}
     const char *GetPrintNameForNode() { return "ReadIntegerExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class ReadLineExpr : public Expr
 {
   public:
-    ReadLineExpr(yyltype loc) : Expr (loc) {type = Type::stringType;}
+    ReadLineExpr(yyltype loc) : Expr (ReadLineExprKind, loc) {SetType(Type::stringType);}
     const char *GetPrintNameForNode() { return "ReadLineExpr"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class PostfixExpr : public Expr
 {
    protected:
      LValue *lvalue;
-     Operator *op;
+     uint32_t opOffset;
+     unsigned char op;  // an Opcode
   public: 
-    PostfixExpr(LValue *lv, Operator *op);
+    PostfixExpr(LValue *lv, Opcode op, SourceLocation opLoc);
     const char *GetPrintNameForNode() { return "PostfixExpr"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+
+    Opcode GetOp() const { return (Opcode)op; }
+    SourceLocation GetOpLocation() const
+        { return SourceLocation(opOffset, strlen(OpToken(GetOp()))); }
 };
 
 #endif
@@ -0,0 +1,804 @@
+/* File: ast_image.cc
+ * ------------------
+ * Implementation of AstImage: the layout of an image, writing one with
+ * a Visitor, and rebuilding a tree from one.
+ */
+
+#include "ast_image.h"
+#include "ast_visitor.h"
+#include "compilation.h"
+#include "intern.h"
+#include "utility.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using std::vector;
+
+static const char Magic[4] = { 'D', 'A', 'S', 'T' };
+static const uint32_t FormatVersion = 2;
+
+struct ImageHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t checked;             // 1 if the tree was checked
+    uint32_t numErrors;
+    uint32_t numNodes, numChildren, numTypes, numStrings;
+    uint32_t numLines, numLiteralTabs;
+    uint64_t stringBytes, textLength;
+    // where each array starts, from the start of the file
+    uint64_t nodes, children, locations, types, strings, stringData;
+    uint64_t lines, literalTabs, text;
+    uint64_t bodyHash;            // see BodyHash()
+};
+
+struct ImageNode {
+    uint8_t kind;                 // a NodeKind
+    uint8_t flags;
+    uint8_t op;                   // the Opcode of a CompoundExpr or PostfixExpr
+    uint8_t unused;
+    uint32_t type;                // of an Expr: index into the types, 0 if none
+    uint32_t firstChild, numChildren;
+    uint32_t a, b;                // see below
+};
+
+// The one child a kind may leave out (ClassDecl's extends, FnDecl's
+// body, IfStmt's else, Case's value, a unary CompoundExpr's left and
+// the base of FieldAccess and Call) is there.
+static const uint8_t HasOptional = 1;
+
+/* What a and b of an ImageNode hold:
+ *   Identifier, StringConstant, Type      a: string index of the name or value
+ *   IntConstant, BoolConstant             a: the value
+ *   DoubleConstant                        a, b: low and high words of the value
+ *   CompoundExpr, PostfixExpr             a: text offset of the operator
+ *   ClassDecl                             a: number of interfaces implemented
+ *   FnDecl                                a: number of formals
+ *   StmtBlock                             a: number of declarations
+ */
+
+struct ImageLocation {
+    uint32_t offset, length;
+};
+
+struct ImageType {
+    uint32_t node;                // of a type in the tree, if name is None
+    uint32_t name;                // string index of a type not in the tree
+};
+
+static const uint32_t None = 0xffffffff;
+
+/* Function: BodyHash()
+ * --------------------
+ * Hashes the header (with bodyHash itself as 0) and then each array in
+ * the order they are in the file, so an image can be checked where it
+ * is mapped. arrays has where each starts.
+ */
+static uint64_t BodyHash(const ImageHeader &header, const void *const arrays[])
+{
+    ImageHeader h = header;
+    h.bodyHash = 0;
+    const uint64_t bytes[] = {
+        h.numNodes * (uint64_t)sizeof(ImageNode),
+        h.numChildren * (uint64_t)sizeof(uint32_t),
+        h.numNodes * (uint64_t)sizeof(ImageLocation),
+        h.numTypes * (uint64_t)sizeof(ImageType),
+        h.numStrings * (uint64_t)sizeof(uint32_t),
+        h.stringBytes,
+        h.numLines * (uint64_t)sizeof(unsigned int),
+        h.numLiteralTabs * (uint64_t)sizeof(unsigned int),
+        h.textLength
+    };
+    const uint64_t mul = 0xff51afd7ed558ccdULL;
+    uint64_t hash = HashBytes((const char *)&h, sizeof(h));
+    for (size_t i = 0; i < sizeof(bytes) / sizeof(bytes[0]); i++)
+        hash = (hash ^ HashBytes((const char *)arrays[i], bytes[i])) * mul;
+    return hash;
+}
+
+
+/* Class: AstImage::Writer
+ * -----------------------
+ * Numbers the nodes as a walk leaves them and fills in the arrays of
+ * the image. When a node is left, the numbers of its children are the
+ * last ones on the stack of finished subtrees. Types are also looked up
+ * by address, for the expressions that have them: a built-in type is
+ * shared by all the nodes that use it, so it is numbered once, the
+ * first time it is left.
+ */
+class AstImage::Writer : public Visitor<AstImage::Writer>
+{
+  public:
+    void Leave(Node *node);
+    bool WriteFile(Compilation *comp, const char *path);
+
+  private:
+    uint32_t StringIndex(const char *s);
+    uint32_t TypeIndex(Type *t);
+
+    vector<ImageNode> nodes;
+    vector<uint32_t> childIndices;
+    vector<ImageLocation> locations;
+    vector<Type *> exprTypes;     // of each node, resolved after the walk
+    vector<ImageType> types;
+    vector<uint32_t> strings;
+    vector<char> stringData;
+    vector<uint32_t> finished;    // numbers of the subtrees not yet a child
+    std::unordered_map<const Node *, uint32_t> typeNodeIndex;
+    std::unordered_map<const char *, uint32_t> stringIndexOf;
+    std::unordered_map<const Type *, uint32_t> typeIndexOf;
+    vector<Node *> children;
+};
+
+uint32_t AstImage::Writer::StringIndex(const char *s)
+{
+    std::unordered_map<const char *, uint32_t>::iterator it = stringIndexOf.find(s);
+    if (it != stringIndexOf.end())
+        return it->second;
+    uint32_t index = strings.size();
+    strings.push_back(stringData.size());
+    stringData.insert(stringData.end(), s, s + strlen(s) + 1);
+    stringIndexOf[s] = index;
+    return index;
+}
+
+uint32_t AstImage::Writer::TypeIndex(Type *t)
+{
+    if (t == NULL)
+        return 0;
+    std::unordered_map<const Type *, uint32_t>::iterator it = typeIndexOf.find(t);
+    if (it != typeIndexOf.end())
+        return it->second;
+
+    ImageType entry;
+    std::unordered_map<const Node *, uint32_t>::iterator node = typeNodeIndex.find(t);
+    if (node != typeNodeIndex.end()) {
+        entry.node = node->second;
+        entry.name = None;
+    } else {
+        entry.node = None;
+        entry.name = StringIndex(t->getTypeName());
+    }
+    uint32_t index = types.size();
+    types.push_back(entry);
+    typeIndexOf[t] = index;
+    return index;
+}
+
+void AstImage::Writer::Leave(Node *node)
+{
+    uint32_t index = nodes.size();
+    if (Type *type = dyn_cast<Type>(node)) {
+        std::pair<std::unordered_map<const Node *, uint32_t>::iterator, bool> seen =
+            typeNodeIndex.insert(std::make_pair(type, index));
+        if (!seen.second) { // a built-in type, left before
+            finished.push_back(seen.first->second);
+            return;
+        }
+    }
+
+    ImageNode image;
+    memset(&image, 0, sizeof(image));
+    image.kind = node->GetKind();
+    children.clear();
+    AppendChildrenOf(node, &children);
+    image.firstChild = childIndices.size();
+    image.numChildren = children.size();
+    Assert(finished.size() >= children.size());
+    childIndices.insert(childIndices.end(), finished.end() - children.size(), finished.end());
+    finished.resize(finished.size() - children.size());
+    finished.push_back(index);
+
+    switch (node->GetKind()) {
+      case IdentifierKind:
+        image.a = StringIndex(cast<Identifier>(node)->GetName());
+        break;
+      case TypeKind:
+        image.a = StringIndex(cast<Type>(node)->getTypeName());
+        break;
+      case StringConstantKind:
+        image.a = StringIndex(static_cast<StringConstant *>(node)->value);
+        break;
+      case IntConstantKind:
+        image.a = static_cast<IntConstant *>(node)->value;
+        break;
+      case BoolConstantKind:
+        image.a = static_cast<BoolConstant *>(node)->value;
+        break;
+      case DoubleConstantKind: {
+        uint64_t bits;
+        memcpy(&bits, &static_cast<DoubleConstant *>(node)->value, sizeof(bits));
+        image.a = (uint32_t)bits;
+        image.b = (uint32_t)(bits >> 32);
+        break;
+      }
+      case ClassDeclKind: {
+        ClassDecl *cls = cast<ClassDecl>(node);
+        if (cls->extends) image.flags |= HasOptional;
+        image.a = cls->implements->NumElements();
+        break;
+      }
+      case FnDeclKind: {
+        FnDecl *fn = cast<FnDecl>(node);
+        if (fn->body) image.flags |= HasOptional;
+        image.a = fn->formals->NumElements();
+        break;
+      }
+      case StmtBlockKind:
+        image.a = static_cast<StmtBlock *>(node)->decls->NumElements();
+        break;
+      case IfStmtKind:
+        if (static_cast<IfStmt *>(node)->elseBody) image.flags |= HasOptional;
+        break;
+      case CaseKind:
+        if (static_cast<Case *>(node)->value) image.flags |= HasOptional;
+        break;
+      case FieldAccessKind:
+        if (cast<FieldAccess>(node)->base) image.flags |= HasOptional;
+        break;
+      case CallKind:
+        if (cast<Call>(node)->base) image.flags |= HasOptional;
+        break;
+      case PostfixExprKind: {
+        PostfixExpr *postfix = static_cast<PostfixExpr *>(node);
+        image.op = postfix->GetOp();
+        image.a = postfix->GetOpLocation().Offset();
+        break;
+      }
+      default:
+        if (node->GetKind() >= FirstCompoundExprKind &&
+            node->GetKind() <= LastCompoundExprKind) {
+            CompoundExpr *compound = static_cast<CompoundExpr *>(node);
+            if (compound->left) image.flags |= HasOptional;
+            image.op = compound->GetOp();
+            image.a = compound->GetOpLocation().Offset();
+        }
+        break;
+    }
+    nodes.push_back(image);
+
+    ImageLocation loc = { node->GetLocation().Offset(), node->GetLocation().Length() };
+    locations.push_back(loc);
+    Expr *expr = dyn_cast<Expr>(node);
+    exprTypes.push_back(expr ? expr->KnownType() : NULL);
+}
+
+// Writes count elements at data and pads the file to a multiple of 8.
+static bool WriteArray(FILE *fp, const void *data, size_t size, size_t count,
+                       uint64_t *offset)
+{
+    static const char zeros[8] = { 0 };
+    size_t bytes = size * count;
+    if (count > 0 && fwrite(data, size, count, fp) != count)
+        return false;
+    size_t pad = (8 - bytes % 8) % 8;
+    if (pad > 0 && fwrite(zeros, 1, pad, fp) != pad)
+        return false;
+    *offset += bytes + pad;
+    return true;
+}
+
+static uint64_t Aligned(uint64_t bytes)
+{
+    return (bytes + 7) / 8 * 8;
+}
+
+bool AstImage::Writer::WriteFile(Compilation *comp, const char *path)
+{
+    types.push_back(ImageType()); // 0, for no type
+    for (size_t i = 0; i < nodes.size(); i++)
+        nodes[i].type = TypeIndex(exprTypes[i]);
+
+    SourceText &source = comp->source;
+    const vector<unsigned int> &lines = source.LineStarts();
+    const vector<unsigned int> &tabs = source.LiteralTabs();
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.checked = comp->WasChecked();
+    header.numErrors = comp->NumErrors();
+    header.numNodes = nodes.size();
+    header.numChildren = childIndices.size();
+    header.numTypes = types.size();
+    header.numStrings = strings.size();
+    header.numLines = lines.size();
+    header.numLiteralTabs = tabs.size();
+    header.stringBytes = stringData.size();
+    header.textLength = source.Length();
+
+    uint64_t at = Aligned(sizeof(header));
+    header.nodes = at;       at += Aligned(nodes.size() * sizeof(ImageNode));
+    header.children = at;    at += Aligned(childIndices.size() * sizeof(uint32_t));
+    header.locations = at;   at += Aligned(locations.size() * sizeof(ImageLocation));
+    header.types = at;       at += Aligned(types.size() * sizeof(ImageType));
+    header.strings = at;     at += Aligned(strings.size() * sizeof(uint32_t));
+    header.stringData = at;  at += Aligned(stringData.size());
+    header.lines = at;       at += Aligned(lines.size() * sizeof(unsigned int));
+    header.literalTabs = at; at += Aligned(tabs.size() * sizeof(unsigned int));
+    header.text = at;
+    const void *arrays[] = { nodes.data(), childIndices.data(), locations.data(),
+                             types.data(), strings.data(), stringData.data(),
+                             lines.data(), tabs.data(), source.Text() };
+    header.bodyHash = BodyHash(header, arrays);
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+        return false;
+    uint64_t written = 0;
+    bool ok = WriteArray(fp, &header, sizeof(header), 1, &written) &&
+              WriteArray(fp, nodes.data(), sizeof(ImageNode), nodes.size(), &written) &&
+              WriteArray(fp, childIndices.data(), sizeof(uint32_t), childIndices.size(), &written) &&
+              WriteArray(fp, locations.data(), sizeof(ImageLocation), locations.size(), &written) &&
+              WriteArray(fp, types.data(), sizeof(ImageType), types.size(), &written) &&
+              WriteArray(fp, strings.data(), sizeof(uint32_t), strings.size(), &written) &&
+              WriteArray(fp, stringData.data(), 1, stringData.size(), &written) &&
+              WriteArray(fp, lines.data(), sizeof(unsigned int), lines.size(), &written) &&
+              WriteArray(fp, tabs.data(), sizeof(unsigned int), tabs.size(), &written) &&
+              WriteArray(fp, source.Text(), 1, source.Length(), &written);
+    Assert(!ok || written == Aligned(header.text + header.textLength));
+    return fclose(fp) == 0 && ok;
+}
+
+bool AstImage::Write(Compilation *comp, const char *path)
+{
+    Assert(comp->GetProgram() != NULL);
+    Writer writer;
+    writer.Walk(comp->GetProgram());
+    return writer.WriteFile(comp, path);
+}
+
+
+/* Function: Array()
+ * -----------------
+ * Returns where in the image of length bytes the array of count
+ * elements of size bytes at offset is, or NULL if it does not fit.
+ */
+template <class T> static const T *Array(const char *data, size_t length,
+                                         uint64_t offset, uint64_t count)
+{
+    if (offset % 8 != 0 || offset > length || count > (length - offset) / sizeof(T))
+        return NULL;
+    return (const T *)(data + offset);
+}
+
+// Where a constructor that takes a yyltype only needs the offsets.
+static yyltype AtOffsets(ImageLocation loc)
+{
+    yyltype at;
+    memset(&at, 0, sizeof(at));
+    at.first_offset = loc.offset;
+    at.last_offset = loc.offset + loc.length - 1;
+    return at;
+}
+
+static Type *TypeNamed(const char *name)
+{
+    Type *builtins[] = { Type::intType, Type::doubleType, Type::boolType,
+                         Type::voidType, Type::nullType, Type::stringType,
+                         Type::errorType };
+    for (Type *t : builtins)
+        if (t->getTypeName() == name)
+            return t;
+    return new Type(name);
+}
+
+/* Class: ImageChildren
+ * --------------------
+ * The children of the node being rebuilt, each fetched as the class its
+ * place calls for. A place past the last child, or a child of the wrong
+ * kind, gives NULL and marks the image bad; Read() checks that before
+ * handing any of them to a constructor.
+ */
+class ImageChildren
+{
+  public:
+    ImageChildren(Node **built, const uint32_t *index, uint32_t count)
+      : bad(false), built(built), index(index), count(count) {}
+
+    template <class T> T *At(uint32_t i)
+    {
+        T *child = i < count ? dyn_cast<T>(built[index[i]]) : NULL;
+        if (!child)
+            bad = true;
+        return child;
+    }
+
+    template <class T, int N> List<T, N> *Range(uint32_t first, uint32_t n)
+    {
+        typedef typename std::remove_pointer<T>::type Element;
+        List<T, N> *list = new List<T, N>;
+        if (first > count || n > count - first) {
+            bad = true;
+            return list;
+        }
+        for (uint32_t i = first; i < first + n && !bad; i++) {
+            Element *child = dyn_cast<Element>(built[index[i]]);
+            if (child)
+                list->Append(child);
+            else
+                bad = true;
+        }
+        return list;
+    }
+
+    bool bad;
+
+  private:
+    Node **built;
+    const uint32_t *index;
+    uint32_t count;
+};
+
+/* Function: AstImage::Read()
+ * --------------------------
+ * Anything wrong with the image, whether the hash does not match or a
+ * number in it is out of range, makes this return NULL rather than
+ * build a tree that would fail later. Every index is checked before it
+ * is used, each child has to be of the kind its place calls for, and
+ * only the built-in types (which the writer numbers once) may be the
+ * child of more than one node, so what is built is a tree.
+ */
+Program *AstImage::Read(Compilation *comp, const char *data, size_t length,
+                        bool *checked, int *numErrors)
+{
+    if (length < sizeof(ImageHeader))
+        return NULL;
+    const ImageHeader *h = (const ImageHeader *)data;
+    if (memcmp(h->magic, Magic, sizeof(Magic)) != 0 || h->version != FormatVersion)
+        return NULL;
+
+    const ImageNode *image = Array<ImageNode>(data, length, h->nodes, h->numNodes);
+    const uint32_t *childIndices = Array<uint32_t>(data, length, h->children, h->numChildren);
+    const ImageLocation *locations = Array<ImageLocation>(data, length, h->locations, h->numNodes);
+    const ImageType *types = Array<ImageType>(data, length, h->types, h->numTypes);
+    const uint32_t *strings = Array<uint32_t>(data, length, h->strings, h->numStrings);
+    const char *stringData = Array<char>(data, length, h->stringData, h->stringBytes);
+    const unsigned int *lines = Array<unsigned int>(data, length, h->lines, h->numLines);
+    const unsigned int *tabs = Array<unsigned int>(data, length, h->literalTabs, h->numLiteralTabs);
+    const char *text = Array<char>(data, length, h->text, h->textLength);
+    if (!image || !childIndices || !locations || !types || !strings || !stringData ||
+        !lines || !tabs || !text || h->numNodes == 0 || h->numTypes == 0)
+        return NULL;
+    const void *arrays[] = { image, childIndices, locations, types, strings,
+                             stringData, lines, tabs, text };
+    if (BodyHash(*h, arrays) != h->bodyHash)
+        return NULL;
+
+    // Every string ends inside the string data if the last one does.
+    if (h->stringBytes > 0 && stringData[h->stringBytes - 1] != '\0')
+        return NULL;
+    for (uint32_t i = 0; i < h->numStrings; i++)
+        if (strings[i] >= h->stringBytes)
+            return NULL;
+    // Lines start in order from the start of the text.
+    if (h->numLines == 0 || lines[0] != 0)
+        return NULL;
+    for (uint32_t i = 1; i < h->numLines; i++)
+        if (lines[i] < lines[i-1] || lines[i] > h->textLength)
+            return NULL;
+
+    vector<Node *> nodes(h->numNodes);
+    vector<bool> isChild(h->numNodes);
+    vector<const char *> names(h->numStrings); // interned as needed
+    for (uint32_t i = 0; i < h->numNodes; i++) {
+        const ImageNode &n = image[i];
+        if (n.firstChild > h->numChildren || n.numChildren > h->numChildren - n.firstChild)
+            return NULL;
+        const uint32_t *c = childIndices + n.firstChild;
+        uint32_t numChildren = n.numChildren;
+        for (uint32_t j = 0; j < numChildren; j++) {
+            if (c[j] >= i || (isChild[c[j]] && image[c[j]].kind != TypeKind))
+                return NULL;
+            isChild[c[j]] = true;
+        }
+        if (locations[i].offset != None &&
+            (locations[i].offset > h->textLength ||
+             locations[i].length > h->textLength - locations[i].offset))
+            return NULL;
+        bool optional = n.flags & HasOptional;
+        SourceLocation loc(locations[i].offset, locations[i].length);
+        yyltype at = AtOffsets(locations[i]);
+        ImageChildren in(nodes.data(), c, numChildren);
+        Node *node = NULL;
+
+        if (n.kind == IdentifierKind || n.kind == TypeKind || n.kind == StringConstantKind) {
+            if (n.a >= h->numStrings)
+                return NULL;
+            if (n.kind != StringConstantKind && names[n.a] == NULL)
+                names[n.a] = Intern(stringData + strings[n.a]);
+        }
+        if (n.kind == PostfixExprKind ||
+            (n.kind >= FirstCompoundExprKind && n.kind <= LastCompoundExprKind)) {
+            if (n.op >= NumOpcodes || n.a > h->textLength)
+                return NULL;
+        }
+
+        switch (n.kind) {
+          case IdentifierKind:
+            node = new Identifier(at, names[n.a]);
+            break;
+          case ProgramKind: {
+            List<Decl*> *decls = in.Range<Decl*, 0>(0, numChildren);
+            if (in.bad)
+                return NULL;
+            node = new Program(decls);
+            break;
+          }
+          case CaseKind: {
+            IntConstant *value = optional ? in.At<IntConstant>(0) : NULL;
+            List<Stmt*, 2> *stmts = in.Range<Stmt*, 2>(optional, numChildren - optional);
+            if (in.bad)
+                return NULL;
+            node = new Case(value, stmts);
+            break;
+          }
+          case VarDeclKind: {
+            Type *type = in.At<Type>(0);
+            Identifier *name = in.At<Identifier>(1);
+            if (in.bad)
+                return NULL;
+            node = new VarDecl(name, type);
+            break;
+          }
+          case ClassDeclKind: {
+            Identifier *name = in.At<Identifier>(0);
+            NamedType *extends = optional ? in.At<NamedType>(1) : NULL;
+            uint32_t implements = 1 + optional;
+            List<NamedType*, 1> *interfaces = in.Range<NamedType*, 1>(implements, n.a);
+            List<Decl*> *members = in.Range<Decl*, 0>(implements + n.a,
+                                                      numChildren - implements - n.a);
+            if (in.bad)
+                return NULL;
+            node = new ClassDecl(name, extends, interfaces, members);
+            break;
+          }
+          case InterfaceDeclKind: {
+            Identifier *name = in.At<Identifier>(0);
+            List<Decl*> *members = in.Range<Decl*, 0>(1, numChildren - 1);
+            if (in.bad)
+                return NULL;
+            node = new InterfaceDecl(name, members);
+            break;
+          }
+          case FnDeclKind: {
+            Type *returnType = in.At<Type>(0);
+            Identifier *name = in.At<Identifier>(1);
+            List<VarDecl*, 2> *formals = in.Range<VarDecl*, 2>(2, n.a);
+            Stmt *body = optional ? in.At<Stmt>(2 + n.a) : NULL;
+            if (in.bad)
+                return NULL;
+            FnDecl *fn = new FnDecl(name, returnType, formals);
+            if (body)
+                fn->SetFunctionBody(body);
+            node = fn;
+            break;
+          }
+          case StmtBlockKind: {
+            List<VarDecl*, 2> *decls = in.Range<VarDecl*, 2>(0, n.a);
+            List<Stmt*, 2> *stmts = in.Range<Stmt*, 2>(n.a, numChildren - n.a);
+            if (in.bad)
+                return NULL;
+            node = new StmtBlock(decls, stmts);
+            break;
+          }
+          case ForStmtKind: {
+            Expr *init = in.At<Expr>(0), *test = in.At<Expr>(1), *step = in.At<Expr>(2);
+            Stmt *body = in.At<Stmt>(3);
+            if (in.bad)
+                return NULL;
+            node = new ForStmt(init, test, step, body);
+            break;
+          }
+          case WhileStmtKind: {
+            Expr *test = in.At<Expr>(0);
+            Stmt *body = in.At<Stmt>(1);
+            if (in.bad)
+                return NULL;
+            node = new WhileStmt(test, body);
+            break;
+          }
+          case IfStmtKind: {
+            Expr *test = in.At<Expr>(0);
+            Stmt *then = in.At<Stmt>(1);
+            Stmt *elseBody = optional ? in.At<Stmt>(2) : NULL;
+            if (in.bad)
+                return NULL;
+            node = new IfStmt(test, then, elseBody);
+            break;
+          }
+          case BreakStmtKind:
+            node = new BreakStmt(at);
+            break;
+          case ReturnStmtKind: {
+            Expr *expr = in.At<Expr>(0);
+            if (in.bad)
+                return NULL;
+            node = new ReturnStmt(at, expr);
+            break;
+          }
+          case PrintStmtKind: {
+            List<Expr*, 2> *args = in.Range<Expr*, 2>(0, numChildren);
+            if (in.bad)
+                return NULL;
+            node = new PrintStmt(args);
+            break;
+          }
+          case SwitchStmtKind: {
+            Expr *expr = in.At<Expr>(0);
+            List<Case*> *cases = in.Range<Case*, 0>(1, numChildren - 1);
+            if (in.bad)
+                return NULL;
+            node = new SwitchStmt(expr, cases);
+            break;
+          }
+          case EmptyExprKind:
+            node = new EmptyExpr();
+            break;
+          case IntConstantKind:
+            node = new IntConstant(at, (int)n.a);
+            break;
+          case DoubleConstantKind: {
+            uint64_t bits = (uint64_t)n.b << 32 | n.a;
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            node = new DoubleConstant(at, value);
+            break;
+          }
+          case BoolConstantKind:
+            node = new BoolConstant(at, n.a != 0);
+            break;
+          case StringConstantKind:
+            node = new StringConstant(at, stringData + strings[n.a]);
+            break;
+          case NullConstantKind:
+            node = new NullConstant(at);
+            break;
+          case ArithmeticExprKind:
+          case LogicalExprKind:
+          case RelationalExprKind:
+          case EqualityExprKind:
+          case AssignExprKind: {
+            Opcode op = (Opcode)n.op;
+            SourceLocation opLoc(n.a, strlen(OpToken(op)));
+            Expr *left = optional ? in.At<Expr>(0) : NULL;
+            Expr *right = in.At<Expr>(optional);
+            // only arithmetic and logical operators can be unary
+            if (in.bad || numChildren != 1u + optional ||
+                (!left && n.kind != ArithmeticExprKind && n.kind != LogicalExprKind))
+                return NULL;
+            if (n.kind == ArithmeticExprKind)
+                node = left ? new ArithmeticExpr(left, op, opLoc, right)
+                            : new ArithmeticExpr(op, opLoc, right);
+            else if (n.kind == LogicalExprKind)
+                node = left ? new LogicalExpr(left, op, opLoc, right)
+                            : new LogicalExpr(op, opLoc, right);
+            else if (n.kind == RelationalExprKind)
+                node = new RelationalExpr(left, op, opLoc, right);
+            else if (n.kind == EqualityExprKind)
+                node = new EqualityExpr(left, op, opLoc, right);
+            else
+                node = new AssignExpr(left, op, opLoc, right);
+            break;
+          }
+          case ArrayAccessKind: {
+            Expr *base = in.At<Expr>(0), *subscript = in.At<Expr>(1);
+            if (in.bad)
+                return NULL;
+            node = new ArrayAccess(at, base, subscript);
+            break;
+          }
+          case FieldAccessKind: {
+            Expr *base = optional ? in.At<Expr>(0) : NULL;
+            Identifier *field = in.At<Identifier>(optional);
+            if (in.bad)
+                return NULL;
+            node = new FieldAccess(base, field);
+            break;
+          }
+          case ThisKind:
+            node = new This(at);
+            break;
+          case CallKind: {
+            Expr *base = optional ? in.At<Expr>(0) : NULL;
+            Identifier *field = in.At<Identifier>(optional);
+            List<Expr*, 2> *args = in.Range<Expr*, 2>(1 + optional, numChildren - 1 - optional);
+            if (in.bad)
+                return NULL;
+            node = new Call(at, base, field, args);
+            break;
+          }
+          case NewExprKind: {
+            NamedType *type = in.At<NamedType>(0);
+            if (in.bad)
+                return NULL;
+            node = new NewExpr(at, type);
+            break;
+          }
+          case NewArrayExprKind: {
+            // The constructor makes the array type around the element
+            // type, so the one built for the image is replaced by it.
+            Expr *size = in.At<Expr>(0);
+            ArrayType *arrayType = in.At<ArrayType>(1);
+            if (in.bad)
+                return NULL;
+            NewArrayExpr *newArray = new NewArrayExpr(at, size, arrayType->getBaseType());
+            nodes[c[1]] = newArray->elemType;
+            node = newArray;
+            break;
+          }
+          case ReadIntegerExprKind:
+            node = new ReadIntegerExpr(at);
+            break;
+          case ReadLineExprKind:
+            node = new ReadLineExpr(at);
+            break;
+          case PostfixExprKind: {
+            Opcode op = (Opcode)n.op;
+            LValue *operand = in.At<LValue>(0);
+            if (in.bad)
+                return NULL;
+            node = new PostfixExpr(operand, op, SourceLocation(n.a, strlen(OpToken(op))));
+            break;
+          }
+          case TypeKind:
+            node = TypeNamed(names[n.a]);
+            break;
+          case NamedTypeKind: {
+            Identifier *name = in.At<Identifier>(0);
+            if (in.bad)
+                return NULL;
+            node = new NamedType(name);
+            break;
+          }
+          case ArrayTypeKind: {
+            Type *elemType = in.At<Type>(0);
+            if (in.bad)
+                return NULL;
+            node = new ArrayType(at, elemType);
+            break;
+          }
+          default:
+            return NULL;
+        }
+        if (n.kind != TypeKind) // not one of the shared built-in types
+            node->location = loc;
+        nodes[i] = node;
+    }
+
+    // The writer numbered each type once, so the expressions that shared
+    // one (all the 'this' in a class) share it again.
+    vector<Type *> named(h->numTypes, NULL);
+    for (uint32_t i = 0; i < h->numNodes; i++) {
+        if (image[i].type == 0)
+            continue;
+        Expr *expr = dyn_cast<Expr>(nodes[i]);
+        if (!expr || image[i].type >= h->numTypes)
+            return NULL;
+        const ImageType &t = types[image[i].type];
+        Type *type;
+        if (named[image[i].type]) {
+            type = named[image[i].type];
+        } else if (t.name == None) {
+            type = t.node < h->numNodes ? dyn_cast<Type>(nodes[t.node]) : NULL;
+        } else if (t.name < h->numStrings) {
+            if (names[t.name] == NULL)
+                names[t.name] = Intern(stringData + strings[t.name]);
+            type = named[image[i].type] = TypeNamed(names[t.name]);
+        } else {
+            type = NULL;
+        }
+        if (!type)
+            return NULL;
+        expr->SetType(type);
+    }
+
+    comp->source.Restore(text, h->textLength, lines, h->numLines, tabs, h->numLiteralTabs);
+    *checked = h->checked != 0;
+    *numErrors = h->numErrors;
+    return dyn_cast<Program>(nodes.back());
+}
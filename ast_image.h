@@ -0,0 +1,58 @@
+/* File: ast_image.h
+ * -----------------
+ * This file declares AstImage, which saves a compilation's tree in a
+ * flat binary file (dcc --emit-ast) and rebuilds the tree from one
+ * (dcc --load-ast) without scanning or parsing again.
+ *
+ * An image has no pointers in it. Nodes are numbered in the order a
+ * Visitor leaves them, so a node's children all come before it and the
+ * tree is the last node. The image holds, each as an array:
+ *
+ *   - the nodes: kind, operator, type, range of children and two words
+ *     whose meaning depends on the kind (a constant's value, the length
+ *     of a list that is followed by another, ...);
+ *   - the children: node numbers, each node's a range of them;
+ *   - where each node is in the text (its SourceLocation);
+ *   - the types the checks gave the expressions: a node of the tree, or
+ *     a type known only by its name (a built-in one, or the type of a
+ *     class as ClassDecl::getType() makes it);
+ *   - the strings: names, interned when loaded, and string constants,
+ *     which are used where they are in the image;
+ *   - the source text and where its lines and literal tabs are, so the
+ *     nodes' locations can be decoded and lines quoted as before.
+ *
+ * Loading maps the file and builds the nodes in one pass from first to
+ * last, each from the ones already built. The image stays mapped for
+ * as long as the Compilation lives. It is in the byte order of the
+ * machine that wrote it; one of another version or order is refused,
+ * as is one whose hash does not match or that does not hold a tree.
+ */
+
+#ifndef _H_ast_image
+#define _H_ast_image
+
+#include <stddef.h>   // for size_t
+
+class Compilation;
+class Program;
+
+class AstImage
+{
+  public:
+    // Writes the tree of comp (which must have one) to path. Returns
+    // false if the file could not be written.
+    static bool Write(Compilation *comp, const char *path);
+
+    // Rebuilds the tree saved in the image at data, in comp's arena,
+    // and restores comp's source text from it. data has to stay mapped
+    // while the tree is in use. Sets *checked to whether the tree had
+    // been checked, and *numErrors to the errors reported before it was
+    // saved. Returns NULL if data is not an image this dcc can read.
+    static Program *Read(Compilation *comp, const char *data, size_t length,
+                         bool *checked, int *numErrors);
+
+  private:
+    class Writer;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/* File: ast_passes.cc
+ * -------------------
+ * Implementation of the visitors run before checking.
+ */
+
+#include "ast_passes.h"
+#include "compilation.h" // for TreeStats
+
+void AssignLevels::Assign(Node *node)
+{
+    Node *parent = node->GetParent();
+    if (parent == NULL)
+        return;
+
+    switch (parent->GetKind()) {
+      case ProgramKind:
+        node->setLevel(1);
+        break;
+      case StmtBlockKind:
+        node->setLevel(parent->getLevel() + 1);
+        break;
+      case FnDeclKind:
+        if (isa<VarDecl>(node)) // not the body
+            node->setLevel(parent->getLevel());
+        break;
+      case ReturnStmtKind:
+        node->setLevel(parent->getLevel());
+        break;
+      default:
+        break;
+    }
+}
+
+void FindContexts::Enter(ReturnStmt *stmt)
+{
+    Assert(!functions.empty());
+    stmt->SetFunction(functions.back());
+}
+
+void CountNodes::Enter(Node *node)
+{
+    stats->nodes++;
+    if (isa<Decl>(node))
+        stats->decls++;
+    else if (isa<Expr>(node))
+        stats->exprs++;
+    else if (isa<Stmt>(node))
+        stats->stmts++;
+
+    if (++depth > stats->depth)
+        stats->depth = depth;
+}
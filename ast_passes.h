@@ -0,0 +1,161 @@
+/* File: ast_passes.h
+ * ------------------
+ * The visitors (see ast_visitor.h) that Compilation::Annotate() runs
+ * over the tree, all in one walk, before it is checked. Each one looks
+ * at a node and what is above it, and leaves what it finds in the
+ * nodes for the checks, which then don't have to search up the tree
+ * for it.
+ */
+
+#ifndef _H_ast_passes
+#define _H_ast_passes
+
+#include "ast_visitor.h"
+#include <vector>
+
+struct TreeStats;
+
+/* Class: AssignLevels
+ * -------------------
+ * Sets the nesting level of declarations and statements: 1 for what is
+ * declared at the top level, one more than its block for what is in a
+ * block, and the level of its function or return statement for a
+ * formal parameter or returned expression.
+ */
+class AssignLevels : public Visitor<AssignLevels>
+{
+  public:
+    using Visitor<AssignLevels>::Enter;
+    void Enter(Decl *decl) { Assign(decl); }
+    void Enter(Stmt *stmt) { Assign(stmt); }
+
+  private:
+    void Assign(Node *node);
+};
+
+/* Class: FindContexts
+ * -------------------
+ * Tells each break statement whether it is inside a loop and each
+ * return statement which function it returns from.
+ */
+class FindContexts : public Visitor<FindContexts>
+{
+  public:
+    FindContexts() : loops(0) {}
+
+    using Visitor<FindContexts>::Enter;
+    using Visitor<FindContexts>::Leave;
+    void Enter(LoopStmt *loop) { loops++; }
+    void Leave(LoopStmt *loop) { loops--; }
+    void Enter(FnDecl *fn) { functions.push_back(fn); }
+    void Leave(FnDecl *fn) { functions.pop_back(); }
+    void Enter(BreakStmt *stmt) { stmt->SetInLoop(loops > 0); }
+    void Enter(ReturnStmt *stmt);
+
+  private:
+    int loops;                       // loops around the node
+    std::vector<FnDecl *> functions; // functions around the node
+};
+
+/* Class: BuildScopes
+ * ------------------
+ * Gives the program, each class, interface and function, and each
+ * statement block its Scope (see scope.h), inside the one around it. A
+ * search for a name stops at a switch case, so the scopes inside one
+ * have none around them.
+ */
+class BuildScopes : public Visitor<BuildScopes>
+{
+  public:
+    using Visitor<BuildScopes>::Enter;
+    using Visitor<BuildScopes>::Leave;
+    void Enter(Program *program) { Open(program); }
+    void Leave(Program *program) { scopes.pop_back(); }
+    void Enter(ClassDecl *cls) { Open(cls); }
+    void Leave(ClassDecl *cls) { scopes.pop_back(); }
+    void Enter(InterfaceDecl *iface) { Open(iface); }
+    void Leave(InterfaceDecl *iface) { scopes.pop_back(); }
+    void Enter(FnDecl *fn) { Open(fn); }
+    void Leave(FnDecl *fn) { scopes.pop_back(); }
+    void Enter(StmtBlock *block) { Open(block); }
+    void Leave(StmtBlock *block) { scopes.pop_back(); }
+    void Enter(Case *c) { scopes.push_back(NULL); }
+    void Leave(Case *c) { scopes.pop_back(); }
+
+  private:
+    template <class N> void Open(N *node)
+    {
+        if (node->GetScope() == NULL) // a class's comes with the program's
+            node->BuildScope(scopes.empty() ? NULL : scopes.back());
+        scopes.push_back(node->GetScope());
+    }
+
+    std::vector<const Scope *> scopes; // innermost last; NULL for a case
+};
+
+/* Class: BindNames
+ * -----------------
+ * Looks up, once, what each use of a name stands for and leaves it with
+ * the use: the declaration a NamedType, or a FieldAccess or Call
+ * without a base, names, and the class a This is in. A name after a
+ * base needs the base's type, so that one is looked up during the
+ * checks, still only once, in the scope and class left with the use.
+ * It keeps the scopes and the classes around the node as it goes, so
+ * it comes after BuildScopes in the walk.
+ */
+class BindNames : public Visitor<BindNames>
+{
+  public:
+    using Visitor<BindNames>::Enter;
+    using Visitor<BindNames>::Leave;
+    void Enter(Program *program) { scopes.push_back(program->GetScope()); }
+    void Leave(Program *program) { scopes.pop_back(); }
+    void Enter(ClassDecl *cls)
+        { scopes.push_back(cls->GetScope()); classes.push_back(cls); }
+    void Leave(ClassDecl *cls) { scopes.pop_back(); classes.pop_back(); }
+    void Enter(InterfaceDecl *iface) { scopes.push_back(iface->GetScope()); }
+    void Leave(InterfaceDecl *iface) { scopes.pop_back(); }
+    void Enter(FnDecl *fn) { scopes.push_back(fn->GetScope()); }
+    void Leave(FnDecl *fn) { scopes.pop_back(); }
+    void Enter(StmtBlock *block) { scopes.push_back(block->GetScope()); }
+    void Leave(StmtBlock *block) { scopes.pop_back(); }
+    void Enter(Case *c) { scopes.push_back(NULL); classes.push_back(NULL); }
+    void Leave(Case *c) { scopes.pop_back(); classes.pop_back(); }
+
+    void Enter(NamedType *type) { type->BindName(InnerScope()); }
+    void Enter(FieldAccess *access)
+        { access->BindName(InnerScope(), InnerClass()); }
+    void Enter(Call *call) { call->BindName(InnerScope()); }
+    void Enter(This *expr) { expr->BindName(InnerClass()); }
+
+  private:
+    const Scope *InnerScope() const
+        { return scopes.empty() ? NULL : scopes.back(); }
+    const ClassDecl *InnerClass() const
+        { return classes.empty() ? NULL : classes.back(); }
+
+    // Both innermost last. A search stops at a switch case, for a name
+    // and for the class, so a case stands in both with NULL.
+    std::vector<const Scope *> scopes;
+    std::vector<const ClassDecl *> classes;
+};
+
+/* Class: CountNodes
+ * -----------------
+ * Counts the nodes of a tree, and of its declarations, statements and
+ * expressions, and how deep it is, in a TreeStats.
+ */
+class CountNodes : public Visitor<CountNodes>
+{
+  public:
+    CountNodes(TreeStats *s) : stats(s), depth(0) {}
+
+    void Enter(Node *node);
+    void Leave(Node *node) { depth--; }
+
+  private:
+    TreeStats *stats;
+    int depth;
+};
+
+#endif
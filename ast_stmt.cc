@@ -7,41 +7,59 @@
 #include "ast_stmt.h"
 #include "ast_type.h"
 #include "errors.h"
+#include "scope.h"
+#include "symbols.h"
+#include <cassert>
 #include <iostream>
 #include <string.h>
 
 using std::cout;
 using std::endl;
 
-Program::Program(List<Decl*> *d) {
+Program::Program(List<Decl*> *d) : Node(ProgramKind) {
     Assert(d != NULL);
     (decls=d)->SetParentAll(this);
+    scope = NULL;
 }
 
 void Program::PrintChildren(int indentLevel) {
     decls->PrintAll(indentLevel+1);
-    printf("\n");
+    PrintText("\n");
 }
 
-void Program::Check() {
-        for(int i = 0; i < decls->NumElements(); i++)
-        {
-            decls->Nth(i)->setLevel(1);
-        }
+void Program::AppendChildren(std::vector<Node *> *children) {
+    children->insert(children->end(), decls->begin(), decls->end());
+}
 
-        int i = 0;
-        while (i < decls->NumElements())
+void Program::CollectDeclarations() {
+        SymbolTables &symbols = CurrentSymbols();
+        for (int i = 0; i < decls->NumElements(); i++)
         {
-                decls->Nth(i)->Check();
-                i++;
+                Decl *d = decls->Nth(i);
+                if (ClassDecl *cls = dyn_cast<ClassDecl>(d))
+                {
+                        add_type(cls->getName(), cls);
+                }
+                else if (FnDecl *fn = dyn_cast<FnDecl>(d))
+                {
+                        symbols.declared_functions.Enter(fn->getName(), fn);
+                }
+                else if (InterfaceDecl *iface = dyn_cast<InterfaceDecl>(d))
+                {
+                        symbols.declared_interfaces.Enter(iface->getName(), iface);
+                }
         }
 }
 
-StmtBlock::StmtBlock(List<VarDecl*> *d, List<Stmt*> *s):Stmt() {
+void Program::CheckStep(CheckWalk *walk, int step) {
+        walk->CheckAll(decls);
+}
+
+StmtBlock::StmtBlock(List<VarDecl*, 2> *d, List<Stmt*, 2> *s):Stmt(StmtBlockKind) {
     Assert(d != NULL && s != NULL);
     (decls=d)->SetParentAll(this);
     (stmts=s)->SetParentAll(this);
-    
+    scope = NULL;
 }
 
 void StmtBlock::PrintChildren(int indentLevel) {
@@ -49,59 +67,56 @@ void StmtBlock::PrintChildren(int indentLevel) {
     stmts->PrintAll(indentLevel+1);
 }
 
-void StmtBlock::Check()
-{
-        for(int i = 0; i < decls->NumElements(); i++)
-        {
-            decls->Nth(i)->setLevel(level+1);
-        }
-        for(int i = 0; i < stmts->NumElements(); i++)
-        {
-            stmts->Nth(i)->setLevel(level+1);
-        }
-
-        int i = 0;
+void StmtBlock::AppendChildren(std::vector<Node *> *children) {
+    children->insert(children->end(), decls->begin(), decls->end());
+    children->insert(children->end(), stmts->begin(), stmts->end());
+}
 
-        while (i < decls->NumElements())
-        {
-                decls->Nth(i)->Check();
-                i++;
-        }
-        i = 0;
-        while (i < stmts->NumElements())
-        {
-                stmts->Nth(i)->Check();
-                i++;
-        }
+void StmtBlock::CheckStep(CheckWalk *walk, int step)
+{
+        walk->CheckAll(decls);
+        walk->CheckAll(stmts);
 }
 
-ConditionalStmt::ConditionalStmt(Expr *t, Stmt *b) { 
+ConditionalStmt::ConditionalStmt(NodeKind k, Expr *t, Stmt *b) : Stmt(k) { 
     Assert(t != NULL && b != NULL);
     (test=t)->SetParent(this); 
     (body=b)->SetParent(this);
 }
 
-ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) { 
+void ConditionalStmt::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(test);
+    children->push_back(body);
+}
+
+ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(ForStmtKind, t, b) { 
     Assert(i != NULL && t != NULL && s != NULL && b != NULL);
     (init=i)->SetParent(this);
     (step=s)->SetParent(this);
 }
 
 void ForStmt::PrintChildren(int indentLevel) {
-    std::cout << isBreakable() << std::endl;
+    PrintText(isBreakable() ? "1\n" : "0\n");
     init->Print(indentLevel+1, "(init) ");
     test->Print(indentLevel+1, "(test) ");
     step->Print(indentLevel+1, "(step) ");
     body->Print(indentLevel+1, "(body) ");
 }
 
+void ForStmt::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(init);
+    children->push_back(test);
+    children->push_back(step);
+    children->push_back(body);
+}
+
 void WhileStmt::PrintChildren(int indentLevel) {
-    std::cout << isBreakable() << std::endl;
+    PrintText(isBreakable() ? "1\n" : "0\n");
     test->Print(indentLevel+1, "(test) ");
     body->Print(indentLevel+1, "(body) ");
 }
 
-IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(t, tb) { 
+IfStmt::IfStmt(Expr *t, Stmt *tb, Stmt *eb): ConditionalStmt(IfStmtKind, t, tb) { 
     Assert(t != NULL && tb != NULL); // else can be NULL
     elseBody = eb;
     if (elseBody) elseBody->SetParent(this);
@@ -113,8 +128,14 @@ void IfStmt::PrintChildren(int indentLevel) {
     if (elseBody) elseBody->Print(indentLevel+1, "(else) ");
 }
 
+void IfStmt::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(test);
+    children->push_back(body);
+    if (elseBody) children->push_back(elseBody);
+}
+
 
-ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) { 
+ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(ReturnStmtKind, loc), function(NULL) { 
     Assert(e != NULL);
     (expr=e)->SetParent(this);
 }
@@ -122,8 +143,12 @@ ReturnStmt::ReturnStmt(yyltype loc, Expr *e) : Stmt(loc) {
 void ReturnStmt::PrintChildren(int indentLevel) {
     expr->Print(indentLevel+1);
 }
+
+void ReturnStmt::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(expr);
+}
   
-PrintStmt::PrintStmt(List<Expr*> *a) {    
+PrintStmt::PrintStmt(List<Expr*, 2> *a) : Stmt(PrintStmtKind) {    
     Assert(a != NULL);
     (args=a)->SetParentAll(this);
 }
@@ -132,13 +157,15 @@ void PrintStmt::PrintChildren(int indentLevel) {
     args->PrintAll(indentLevel+1, "(args) ");
 }
 
-void PrintStmt::Check() {
-        int i = 0;
+void PrintStmt::AppendChildren(std::vector<Node *> *children) {
+    children->insert(children->end(), args->begin(), args->end());
+}
 
-        while (i < args->NumElements())
+void PrintStmt::CheckStep(CheckWalk *walk, int step) {
+        /* step i + 1 looks at argument i once it has been checked */
+        if (step > 0)
         {
-                args->Nth(i)->Check();
-
+                int i = step - 1;
                 const Type *t = args->Nth(i)->getType();
                 assert(t);
                 if (t != Type::intType && t != Type::boolType &&
@@ -149,22 +176,22 @@ void PrintStmt::Check() {
                                         i + 1,
                                         t->getTypeName());
                 }
-                i++;
+        }
+
+        if (step < args->NumElements())
+        {
+                walk->Check(args->Nth(step));
+                walk->Then(this, step + 1);
         }
 }
 
-void BreakStmt::Check() { //DONE
-    Node* p = parent;
-    while(p != nullptr)
-    {    if(p->isBreakable())
-            return;
-         else
-            p = p->GetParent();
-    }
+void BreakStmt::CheckStep(CheckWalk *walk, int step) { //DONE
+    if (inLoop)
+        return;
     ReportError::Formatted(location, "break is only allowed inside a loop");
 }
 
-Case::Case(IntConstant *v, List<Stmt*> *s) {
+Case::Case(IntConstant *v, List<Stmt*, 2> *s) : Node(CaseKind) {
     Assert(s != NULL);
     value = v;
     if (value) value->SetParent(this);
@@ -176,7 +203,12 @@ void Case::PrintChildren(int indentLevel) {
     stmts->PrintAll(indentLevel+1);
 }
 
-SwitchStmt::SwitchStmt(Expr *e, List<Case*> *c) {
+void Case::AppendChildren(std::vector<Node *> *children) {
+    if (value) children->push_back(value);
+    children->insert(children->end(), stmts->begin(), stmts->end());
+}
+
+SwitchStmt::SwitchStmt(Expr *e, List<Case*> *c) : Stmt(SwitchStmtKind) {
     Assert(e != NULL && c != NULL);
     (expr=e)->SetParent(this);
     (cases=c)->SetParentAll(this);
@@ -187,78 +219,97 @@ void SwitchStmt::PrintChildren(int indentLevel) {
     cases->PrintAll(indentLevel+1);
 }
 
-void SwitchStmt::Check() {
-    int i = 0;
-
-    expr->Check(); //Evaluate to int
+void SwitchStmt::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(expr);
+    children->insert(children->end(), cases->begin(), cases->end());
+}
 
-    while (i < cases->NumElements())
-    {
-            cases->Nth(i)->Check();
-            i++;
-    }
+void SwitchStmt::CheckStep(CheckWalk *walk, int step) {
+    walk->Check(expr); //Evaluate to int
+    walk->CheckAll(cases);
 }
 
-void ConditionalStmt::Check() {
-        test->Check();
-        if(test->getType() != Type::boolType)
+void ConditionalStmt::CheckStep(CheckWalk *walk, int step) {
+        switch (step)
         {
-                ReportError::Formatted(location,
-                                "Test expression must have boolean type");
+        case 0:
+                walk->Check(test);
+                walk->Then(this, 1);
+                break;
+        case 1:
+                if(test->getType() != Type::boolType)
+                {
+                        ReportError::Formatted(location,
+                                        "Test expression must have boolean type");
+                }
+                walk->Check(body);
+                break;
         }
-        body->Check();
 }
 
-void ForStmt::Check() {
-        init->Check(); 
-        test->Check();
-        if(test->getType() != Type::errorType &&
-                        test->getType() != Type::boolType)
+void ForStmt::CheckStep(CheckWalk *walk, int step) {
+        /* careful: this->step is the loop's step expression */
+        switch (step)
         {
-                ReportError::Formatted(test->GetLocation(),
-                                "Test expression must have boolean type");
+        case 0:
+                walk->Check(init);
+                walk->Check(test);
+                walk->Then(this, 1);
+                break;
+        case 1:
+                if(test->getType() != Type::errorType &&
+                                test->getType() != Type::boolType)
+                {
+                        ReportError::Formatted(test->GetLocation(),
+                                        "Test expression must have boolean type");
+                }
+                walk->Check(this->step);
+                walk->Check(body);
+                break;
         }
-        step->Check();
-        body->Check();
 }
 
-void IfStmt::Check() {
-        test->Check();
-        if(test->getType() != Type::errorType &&
-                        test->getType() != Type::boolType)
+void IfStmt::CheckStep(CheckWalk *walk, int step) {
+        switch (step)
         {
-                ReportError::Formatted(test->GetLocation(),
-                                "Test expression must have boolean type");
-        }
+        case 0:
+                walk->Check(test);
+                walk->Then(this, 1);
+                break;
+        case 1:
+                if(test->getType() != Type::errorType &&
+                                test->getType() != Type::boolType)
+                {
+                        ReportError::Formatted(test->GetLocation(),
+                                        "Test expression must have boolean type");
+                }
 
-        body->Check();
+                walk->Check(body);
 
-        if (elseBody != nullptr)
-        {
-                elseBody->Check();
+                if (elseBody != nullptr)
+                {
+                        walk->Check(elseBody);
+                }
+                break;
         }
 }
 
-void ReturnStmt::Check() {
-        expr->setLevel(level);
-        expr->Check();
+void ReturnStmt::CheckStep(CheckWalk *walk, int step) {
+        if (step == 0)
+        {
+                walk->Check(expr);
+                walk->Then(this, 1);
+                return;
+        }
+
         const Type* t = expr->getType();
         if (t == nullptr)
         {
                 t = Type::voidType;
         }
         
-        Node *par = this;
-        FnDecl *fn = nullptr;
-        while (true)
-        {
-                par = par->GetParent();
-                fn = dynamic_cast<FnDecl*>(par);
-                if (fn != nullptr)
-                {
-                        break;
-                }
-        }
+        FnDecl *fn = function;
+        Assert(fn != nullptr);
 
         if (fn->getType()->operator!=(t))
         {
@@ -272,48 +323,55 @@ void ReturnStmt::Check() {
         }
 }
 
-void Case::Check() {
-        int i = 0;
-
-        while (i < stmts->NumElements())
-        {
-                stmts->Nth(i)->Check();
-                i++;
-        }
+void Case::CheckStep(CheckWalk *walk, int step) {
+        walk->CheckAll(stmts);
 }
 
-const Decl *StmtBlock::getVariable(const char *name) const
+void StmtBlock::BuildScope(const Scope *outer)
 {
-        for (int i = 0; i < decls->NumElements(); i++)
+        scope = new Scope(this, outer, decls->NumElements());
+        for (VarDecl *d : *decls)
         {
-                if (strcmp(decls->Nth(i)->getName(), name) == 0)
-                {
-                        return decls->Nth(i);
-                }
+                scope->Declare(d);
         }
+}
 
-        return parent->getVariable(name);
+Node::Search StmtBlock::LookupHere(const char *name, const Decl **found) const
+{
+        Assert(scope != nullptr);
+        *found = scope->Lookup(name);
+        return *found != nullptr ? Stop : Continue;
 }
 
-const Decl *Program::getVariable(const char *name) const
+/* A class searches its superclass, which may be declared further on,
+ * so the classes get their scopes along with the program's.
+ */
+void Program::BuildScope(const Scope *outer)
 {
-        for (int i = 0; i < decls->NumElements(); i++)
+        scope = new Scope(this, outer, decls->NumElements());
+        for (Decl *d : *decls)
+        {
+                scope->Declare(d);
+        }
+        for (Decl *d : *decls)
         {
-                if (strcmp(decls->Nth(i)->getName(), name) == 0)
+                if (ClassDecl *cls = dyn_cast<ClassDecl>(d))
                 {
-                        return decls->Nth(i);
+                        cls->BuildScope(scope);
                 }
         }
-
-        return nullptr;
+        ClassDecl::BuildMemberTables(decls);
+        ClassDecl::NumberClasses(decls);
 }
 
-const Decl *Stmt::getVariable(const char *name) const
+Node::Search Program::LookupHere(const char *name, const Decl **found) const
 {
-        return parent->getVariable(name);
+        Assert(scope != nullptr);
+        *found = scope->Lookup(name);
+        return Stop;
 }
 
-const ClassDecl *Stmt::getThis() const
+Node::Search Stmt::LookupHere(const char *name, const Decl **found) const
 {
-        return parent->getThis();
+        return Continue;
 }
@@ -16,46 +16,65 @@
 class Decl;
 class VarDecl;
 class Expr;
+class FnDecl;
   
 class Program : public Node
 {
   protected:
      List<Decl*> *decls;
+     Scope *scope;
      
   public:
      Program(List<Decl*> *declList);
+     static bool classof(const Node *n) { return n->GetKind() == ProgramKind; }
      const char *GetPrintNameForNode() { return "Program"; }
      void PrintChildren(int indentLevel);
-     virtual void Check();
-
-     virtual const Decl *getVariable(const char *name) const;
+     void AppendChildren(std::vector<Node *> *children);
+     virtual void CheckStep(CheckWalk *walk, int step);
+
+     // Enters the classes, functions and interfaces declared at the top
+     // level in the current compilation's symbol tables.
+     void CollectDeclarations();
+
+     // Makes the scope of the top-level declarations (see scope.h),
+     // and the scopes and member tables of the classes among them.
+     // BuildScopes does this for the whole tree.
+     void BuildScope(const Scope *outer);
+     virtual const Scope *GetScope() const { return scope; }
+     virtual Search LookupHere(const char *name, const Decl **found) const;
 };
 
 class Stmt : public Node
 {
   public:
-     bool canBeBroken;
-     Stmt() : Node() {}
-     Stmt(yyltype loc) : Node(loc) {}
-
-     virtual const Decl *getVariable(const char *name) const;
+     Stmt(NodeKind kind) : Node(kind) {}
+     Stmt(NodeKind kind, SourceLocation loc) : Node(kind, loc) {}
+     static bool classof(const Node *n)
+         { return n->GetKind() >= FirstStmtKind && n->GetKind() <= LastStmtKind; }
 
-     virtual const ClassDecl *getThis() const;
+     virtual Search LookupHere(const char *name, const Decl **found) const;
 };
 
 class StmtBlock : public Stmt 
 {
+    friend class AstImage;
   protected:
-    List<VarDecl*> *decls;
-    List<Stmt*> *stmts;
+    List<VarDecl*, 2> *decls;
+    List<Stmt*, 2> *stmts;
+    Scope *scope;
     
   public:
-    StmtBlock(List<VarDecl*> *variableDeclarations, List<Stmt*> *statements);
+    StmtBlock(List<VarDecl*, 2> *variableDeclarations, List<Stmt*, 2> *statements);
     const char *GetPrintNameForNode() { return "StmtBlock"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
-
-    virtual const Decl *getVariable(const char *name) const;
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+
+    // Makes the scope of what is declared here, inside outer (see
+    // scope.h). BuildScopes does this for the whole tree.
+    void BuildScope(const Scope *outer);
+    virtual const Scope *GetScope() const { return scope; }
+    virtual Search LookupHere(const char *name, const Decl **found) const;
 };
 
   
@@ -66,15 +85,18 @@ class ConditionalStmt : public Stmt
     Stmt *body;
   
   public:
-    ConditionalStmt(Expr *testExpr, Stmt *body);
-    virtual void Check();
+    ConditionalStmt(NodeKind kind, Expr *testExpr, Stmt *body);
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class LoopStmt : public ConditionalStmt 
 {
   public:
-    LoopStmt(Expr *testExpr, Stmt *body)
-            : ConditionalStmt(testExpr, body) {}
+    LoopStmt(NodeKind kind, Expr *testExpr, Stmt *body)
+            : ConditionalStmt(kind, testExpr, body) {}
+    static bool classof(const Node *n)
+        { return n->GetKind() >= FirstLoopStmtKind && n->GetKind() <= LastLoopStmtKind; }
 };
 
 class ForStmt : public LoopStmt 
@@ -86,14 +108,15 @@ class ForStmt : public LoopStmt
     ForStmt(Expr *init, Expr *test, Expr *step, Stmt *body);
     const char *GetPrintNameForNode() { return "ForStmt"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
     bool isBreakable(){return true;}
 };
 
 class WhileStmt : public LoopStmt 
 {
   public:
-    WhileStmt(Expr *test, Stmt *body) : LoopStmt(test, body) {}
+    WhileStmt(Expr *test, Stmt *body) : LoopStmt(WhileStmtKind, test, body) {}
     const char *GetPrintNameForNode() { return "WhileStmt"; }
     void PrintChildren(int indentLevel);
     bool isBreakable(){return true;}
@@ -101,6 +124,7 @@ class WhileStmt : public LoopStmt
 
 class IfStmt : public ConditionalStmt 
 {
+    friend class AstImage;
   protected:
     Stmt *elseBody;
   
@@ -108,39 +132,48 @@ class IfStmt : public ConditionalStmt
     IfStmt(Expr *test, Stmt *thenBody, Stmt *elseBody);
     const char *GetPrintNameForNode() { return "IfStmt"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class BreakStmt : public Stmt 
 {
+  protected:
+    bool inLoop; // set by FindContexts (see ast_passes.h)
+
   public:
-    BreakStmt(yyltype loc) : Stmt(loc) {}
+    BreakStmt(yyltype loc) : Stmt(BreakStmtKind, loc), inLoop(false) {}
     const char *GetPrintNameForNode() { return "BreakStmt"; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
+    void SetInLoop(bool b) { inLoop = b; }
 };
 
 class ReturnStmt : public Stmt  
 {
   protected:
     Expr *expr;
+    FnDecl *function; // the one returned from, set by FindContexts
   
   public:
     ReturnStmt(yyltype loc, Expr *expr);
     const char *GetPrintNameForNode() { return "ReturnStmt"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
+    void SetFunction(FnDecl *fn) { function = fn; }
 };
 
 class PrintStmt : public Stmt
 {
   protected:
-    List<Expr*> *args;
+    List<Expr*, 2> *args;
     
   public:
-    PrintStmt(List<Expr*> *arguments);
+    PrintStmt(List<Expr*, 2> *arguments);
     const char *GetPrintNameForNode() { return "PrintStmt"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 
@@ -148,15 +181,18 @@ class IntConstant;
 
 class Case : public Node
 {
+    friend class AstImage;
   protected:
     IntConstant *value;
-    List<Stmt*> *stmts;
+    List<Stmt*, 2> *stmts;
     
   public:
-    Case(IntConstant *v, List<Stmt*> *stmts);
+    Case(IntConstant *v, List<Stmt*, 2> *stmts);
+    static bool classof(const Node *n) { return n->GetKind() == CaseKind; }
     const char *GetPrintNameForNode() { return value ? "Case" :"Default"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 class SwitchStmt : public Stmt
@@ -169,7 +205,8 @@ class SwitchStmt : public Stmt
     SwitchStmt(Expr *e, List<Case*> *cases);
     const char *GetPrintNameForNode() { return "SwitchStmt"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 };
 
 #endif
@@ -11,6 +11,7 @@
 #include <cassert>
 #include <iostream>
 #include "ast_expr.h"
+#include "intern.h"
 
 using namespace std;
  
@@ -30,12 +31,13 @@ Type *Type::nullType   = new Type("null");
 Type *Type::stringType = new Type("string");
 Type *Type::errorType  = new Type("error"); 
 
-Type::Type(const char *n) {
+Type::Type(const char *n) : Node(TypeKind) {
     Assert(n);
-    typeName = strdup(n);
+    typeName = Intern(n);
+    builtin = true;
 }
 
-void Type::Check()
+void Type::CheckStep(CheckWalk *walk, int step)
 {
         if (typeName == nullptr)
         {
@@ -57,21 +59,26 @@ void Type::Check()
 }
 
 void Type::PrintChildren(int indentLevel) {
-    printf("%s", typeName);
+    Printf("%s", typeName);
 }
 
-NamedType::NamedType(Identifier *i) : Type(*i->GetLocation()) {
+NamedType::NamedType(Identifier *i) : Type(NamedTypeKind, i->GetLocation()) {
     Assert(i != NULL);
     (id=i)->SetParent(this);
+    decl = NULL;
 } 
 
-void NamedType::Check()
+NamedType::NamedType(Identifier *i, const Decl *d) : NamedType(i) {
+    decl = d;
+}
+
+void NamedType::CheckStep(CheckWalk *walk, int step)
 {
-        const Decl *par = getVariable(id->GetName());
+        const Decl *par = decl;
         if (par == nullptr)
         {
-                if (dynamic_cast<VarDecl*>(parent) != nullptr ||
-                                dynamic_cast<NewArrayExpr*>(parent) != nullptr)
+                if (isa<VarDecl>(parent) ||
+                                isa<NewArrayExpr>(parent))
                 {
                         ReportError::Formatted(location,
                                         "No declaration found for type '%s'",
@@ -84,11 +91,11 @@ void NamedType::Check()
                 return;
         }
 
-        if (dynamic_cast<const ClassDecl*>(par) == nullptr &&
-                        dynamic_cast<const InterfaceDecl*>(par) == nullptr)
+        if (!isa<ClassDecl>(par) &&
+                        !isa<InterfaceDecl>(par))
         {
-                if (dynamic_cast<VarDecl*>(parent) != nullptr ||
-                                dynamic_cast<ArrayType*>(parent) != nullptr)
+                if (isa<VarDecl>(parent) ||
+                                isa<ArrayType>(parent))
                 {
                         ReportError::Formatted(location,
                                         "No declaration found for type '%s'",
@@ -106,17 +113,29 @@ void NamedType::PrintChildren(int indentLevel) {
     id->Print(indentLevel+1);
 }
 
-ArrayType::ArrayType(yyltype loc, Type *et) : Type(loc) {
+void NamedType::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(id);
+}
+
+ArrayType::ArrayType(yyltype loc, Type *et) : Type(ArrayTypeKind, loc) {
     Assert(et != NULL);
     (elemType=et)->SetParent(this);
+    // Made once here, as the checks ask for it again and again.
+    string name = string(elemType->getTypeName());
+    name += "[]";
+    typeName = Intern(name.c_str());
 }
 
 void ArrayType::PrintChildren(int indentLevel) {
     elemType->Print(indentLevel+1);
 }
 
-void ArrayType::Check() {
-        elemType->Check();
+void ArrayType::AppendChildren(std::vector<Node *> *children) {
+    children->push_back(elemType);
+}
+
+void ArrayType::CheckStep(CheckWalk *walk, int step) {
+        walk->Check(elemType);
 }
 
 bool NamedType::IsDeclared() {
@@ -125,14 +144,7 @@ bool NamedType::IsDeclared() {
 
 bool Type::operator!=(const Type *rhs) const
 {
-        return (strcmp(getTypeName(), rhs->getTypeName()) != 0);
-}
-
-const char *ArrayType::getTypeName() const
-{
-      string name = string(elemType->getTypeName());
-      name += "[]";
-      return strdup(name.c_str());
+        return getTypeName() != rhs->getTypeName(); // both interned
 }
 
 Type *ArrayType::getBaseType() const
@@ -142,7 +154,7 @@ Type *ArrayType::getBaseType() const
 
 bool NamedType::isDescendedFrom(const Type *other) const
 {
-        const Decl *me = parent->getVariable(getTypeName());
+        const Decl *me = decl != nullptr ? decl : parent->getVariable(getTypeName());
         const Decl *par = parent->getVariable(other->getTypeName());
 
         if (me == nullptr || par == nullptr)
@@ -150,10 +162,10 @@ bool NamedType::isDescendedFrom(const Type *other) const
                 return false;
         }
 
-        return me->descendedFrom(par->getName());
+        return me->descendedFrom(par);
 }
 
-const Decl *Type::getVariable(const char *name) const
+Node::Search Type::LookupHere(const char *name, const Decl **found) const
 {
-        return parent->getVariable(name);
+        return Continue;
 }
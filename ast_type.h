@@ -17,39 +17,57 @@
 class Type : public Node 
 {
   protected:
-    char *typeName;
+    const char *typeName; // interned
+    bool builtin;
 
   public :
     static Type *intType, *doubleType, *boolType, *voidType,
                 *nullType, *stringType, *errorType;
 
-    Type(yyltype loc) : Node(loc) {}
+    Type(NodeKind kind, SourceLocation loc) : Node(kind, loc), builtin(false) {}
     Type(const char *str);
+    static bool classof(const Node *n)
+        { return n->GetKind() >= FirstTypeKind && n->GetKind() <= LastTypeKind; }
+
+    // The built-in types are shared by every compilation (and every
+    // thread), so they are never given a parent.
+    void SetParent(Node *p) { if (!builtin) parent = p; }
     
     const char *GetPrintNameForNode() { return "Type"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
     virtual const char *getTypeName() const {return typeName;}
     virtual bool operator!=(const Type *rhs) const;
     virtual bool isDescendedFrom(const Type *other) const { return false; }
     virtual bool isBasicType() const {return true;}
-    virtual const Decl *getVariable(const char *name) const;
+    virtual Search LookupHere(const char *name, const Decl **found) const;
 };
 
 class NamedType : public Type 
 {
   protected:
     Identifier *id;
+    const Decl *decl;
     
   public:
     NamedType(Identifier *i);
+    // A name already known to stand for d, such as a class's own type
+    NamedType(Identifier *i, const Decl *d);
+    static bool classof(const Node *n) { return n->GetKind() == NamedTypeKind; }
     
     const char *GetPrintNameForNode() { return "NamedType"; }
     void PrintChildren(int indentLevel);
+    void AppendChildren(std::vector<Node *> *children);
     bool IsDeclared();
     const Identifier * GetId() { return id; }
-    virtual void Check();
+    virtual void CheckStep(CheckWalk *walk, int step);
     const char *getTypeName() const {return id->GetName();}
+    // What the name stands for where it is written, or NULL; looked up
+    // once by BindName(), which BindNames calls before the checks with
+    // the scope the name is written in.
+    void BindName(const Scope *scope)
+        { decl = getVariable(scope, id->GetName()); }
+    const Decl *GetDecl() const { return decl; }
     virtual bool isDescendedFrom(const Type *other) const;
     virtual bool isBasicType() const {return false;}
 };
@@ -61,11 +79,12 @@ class ArrayType : public Type
 
   public:
     ArrayType(yyltype loc, Type *elemType);
+    static bool classof(const Node *n) { return n->GetKind() == ArrayTypeKind; }
     
     const char *GetPrintNameForNode() { return "ArrayType"; }
     void PrintChildren(int indentLevel);
-    virtual void Check();
-    const char *getTypeName() const;
+    void AppendChildren(std::vector<Node *> *children);
+    virtual void CheckStep(CheckWalk *walk, int step);
 
     Type *getBaseType() const;
 };
@@ -0,0 +1,16 @@
+/* File: ast_visitor.cc
+ * --------------------
+ * Finding a node's children for a Visitor's walk.
+ */
+
+#include "ast_visitor.h"
+
+void AppendChildrenOf(Node *node, std::vector<Node *> *children)
+{
+    switch (node->GetKind()) {
+#define APPEND_CASE(C) case C##Kind: static_cast<C *>(node)->AppendChildren(children); break;
+        AST_NODE_CLASSES(APPEND_CASE)
+#undef APPEND_CASE
+      default: Assert(0);
+    }
+}
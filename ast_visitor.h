@@ -0,0 +1,144 @@
+/* File: ast_visitor.h
+ * -------------------
+ * This file defines Visitor, a base for analyses that want to see every
+ * node of a tree, and FusedVisitor, which runs several of them in one
+ * walk.
+ *
+ * A visitor is a class V derived from Visitor<V>. It overloads Enter()
+ * and Leave() for the node classes it cares about; Enter() is called on
+ * a node before its children are walked and Leave() after. A walk calls
+ * the most specific overload for each node's class, going by the
+ * node's kind and never through a virtual function, so Enter(LoopStmt*)
+ * sees both ForStmt and WhileStmt nodes, and the Enter(Node*) and
+ * Leave(Node*) that Visitor supplies (which do nothing) take the rest.
+ * A visitor that overloads Enter() or Leave() has to say
+ *
+ *     using Visitor<V>::Enter;
+ *     using Visitor<V>::Leave;
+ *
+ * for those to still be found.
+ *
+ * Walk() visits every node, children in the order Print() prints them,
+ * on an explicit work stack the way Check() does, so a tree of any depth
+ * can be walked. Each walk reads the whole tree, so analyses that only
+ * need a look at each node are best run together with WalkFused():
+ *
+ *     AssignLevels levels;
+ *     FindContexts contexts;
+ *     WalkFused(program, levels, contexts);
+ *
+ * does what levels.Walk(program) and then contexts.Walk(program) would,
+ * calling each node's Enter() for levels and then for contexts, in one
+ * walk of the tree.
+ */
+
+#ifndef _H_ast_visitor
+#define _H_ast_visitor
+
+#include "ast.h"
+#include "ast_decl.h"
+#include "ast_expr.h"
+#include "ast_stmt.h"
+#include "ast_type.h"
+#include <utility>
+#include <vector>
+
+/* Function: AppendChildrenOf()
+ * ----------------------------
+ * Adds node's children to the end of children, in the order Print()
+ * prints them, by calling the AppendChildren() of the node's class.
+ */
+void AppendChildrenOf(Node *node, std::vector<Node *> *children);
+
+
+template <class Derived> class Visitor
+{
+  public:
+    void Walk(Node *root);
+
+    void Enter(Node *node) {}
+    void Leave(Node *node) {}
+};
+
+template <class Derived> void Visitor<Derived>::Walk(Node *root)
+{
+    Derived *self = static_cast<Derived *>(this);
+    // NULL on the stack marks where the children of the node under it
+    // end, so that the node is left once they have all been walked.
+    std::vector<Node *> work(1, root);
+
+    while (!work.empty()) {
+        Node *node = work.back();
+        work.pop_back();
+
+        if (node == NULL) {
+            node = work.back();
+            work.pop_back();
+            switch (node->GetKind()) {
+#define LEAVE_CASE(C) case C##Kind: self->Leave(static_cast<C *>(node)); break;
+                AST_NODE_CLASSES(LEAVE_CASE)
+#undef LEAVE_CASE
+              default: Assert(0);
+            }
+            continue;
+        }
+
+        switch (node->GetKind()) {
+#define ENTER_CASE(C) case C##Kind: self->Enter(static_cast<C *>(node)); break;
+            AST_NODE_CLASSES(ENTER_CASE)
+#undef ENTER_CASE
+          default: Assert(0);
+        }
+        work.push_back(node);
+        work.push_back(NULL);
+        size_t first = work.size();
+        AppendChildrenOf(node, &work);
+        for (size_t i = first, j = work.size(); i + 1 < j; i++, j--)
+            std::swap(work[i], work[j - 1]); // first child on top
+    }
+}
+
+
+/* Class: FusedVisitor
+ * -------------------
+ * A visitor that hands each node to a list of other visitors in turn,
+ * so that they all get done in one walk. The visitors are held by
+ * reference and keep what they find. Passes<...> is the list, one
+ * visitor at a time.
+ */
+template <class... Visitors> struct Passes;
+
+template <> struct Passes<>
+{
+    template <class N> void Enter(N *node) {}
+    template <class N> void Leave(N *node) {}
+};
+
+template <class First, class... Rest> struct Passes<First, Rest...>
+{
+    First &first;
+    Passes<Rest...> rest;
+
+    Passes(First &f, Rest &... r) : first(f), rest(r...) {}
+    template <class N> void Enter(N *node) { first.Enter(node); rest.Enter(node); }
+    template <class N> void Leave(N *node) { first.Leave(node); rest.Leave(node); }
+};
+
+template <class... Visitors>
+class FusedVisitor : public Visitor<FusedVisitor<Visitors...> >
+{
+  public:
+    FusedVisitor(Visitors &... visitors) : passes(visitors...) {}
+    template <class N> void Enter(N *node) { passes.Enter(node); }
+    template <class N> void Leave(N *node) { passes.Leave(node); }
+
+  private:
+    Passes<Visitors...> passes;
+};
+
+template <class... Visitors> void WalkFused(Node *root, Visitors &... visitors)
+{
+    FusedVisitor<Visitors...>(visitors...).Walk(root);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/* File: cast_bench.cc
+ * -------------------
+ * A program of its own (make cast_bench) that times the kind checks of
+ * ast.h (isa<>, dyn_cast<>) against the dynamic_casts they replaced, on
+ * the nodes of real trees. It parses the file named on the command line
+ * (by default samples/matrix.decaf) as many times as asked (by default
+ * 2000), so that the trees add up to a class-heavy program too big for
+ * the caches, and then asks of every node whether it is each of the
+ * classes the checker asks about, first with dynamic_cast and then with
+ * dyn_cast<>. It prints the nanoseconds per question for each, the best
+ * of five runs.
+ *
+ *     ./cast_bench [file [copies]]
+ */
+
+#include "compilation.h"
+#include "parser.h"   // for InitParser()
+#include "ast_visitor.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+/* Class: CollectNodes
+ * -------------------
+ * Adds every node of a tree to nodes, in the order of a walk.
+ */
+class CollectNodes : public Visitor<CollectNodes>
+{
+  public:
+    using Visitor<CollectNodes>::Enter;
+    CollectNodes(std::vector<Node *> *n) : nodes(n) {}
+    void Enter(Node *node) { nodes->push_back(node); }
+
+  private:
+    std::vector<Node *> *nodes;
+};
+
+static volatile long sink; // so the answers are not optimized away
+
+template <class F> static double BestNanosecondsPer(size_t questions, F run)
+{
+    double best = 1e30;
+    for (int i = 0; i < 5; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        sink = run();
+        std::chrono::duration<double, std::nano> taken = std::chrono::steady_clock::now() - start;
+        best = std::min(best, taken.count() / questions);
+    }
+    return best;
+}
+
+/* Times asking of every node whether it is a T, both ways, and checks
+ * that the two ways agree.
+ */
+template <class T> static void Time(const char *name, const std::vector<Node *> &nodes)
+{
+    long expected = 0;
+    double dynamic = BestNanosecondsPer(nodes.size(), [&] {
+        long found = 0;
+        for (Node *node : nodes)
+            found += dynamic_cast<T *>(node) != NULL;
+        return expected = found;
+    });
+    long got = 0;
+    double kind = BestNanosecondsPer(nodes.size(), [&] {
+        long found = 0;
+        for (Node *node : nodes)
+            found += dyn_cast<T>(node) != NULL;
+        return got = found;
+    });
+    if (got != expected) {
+        printf("%s: dyn_cast<> found %ld, dynamic_cast %ld\n", name, got, expected);
+        exit(1);
+    }
+    printf("%-12s %10ld %14.2f %10.2f\n", name, got, dynamic, kind);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "samples/matrix.decaf";
+    int copies = argc > 2 ? atoi(argv[2]) : 2000;
+
+    InitParser();
+    std::vector<Compilation *> comps;
+    std::vector<Node *> nodes;
+    for (int i = 0; i < copies; i++) {
+        Compilation *comp = new Compilation(path);
+        if (!comp->Load()) {
+            fprintf(stderr, "Cannot open source file '%s'\n", path);
+            return 2;
+        }
+        Program *program = comp->Parse();
+        if (!program) {
+            fprintf(stderr, "%s does not parse\n", path);
+            return 2;
+        }
+        CollectNodes(&nodes).Walk(program);
+        comps.push_back(comp); // the nodes live as long as it does
+    }
+
+    printf("%d copies of %s: %lu nodes\n", copies, path, (unsigned long)nodes.size());
+    printf("%-12s %10s %14s %10s  (ns per node)\n", "class", "found", "dynamic_cast", "dyn_cast");
+    Time<Decl>("Decl", nodes);
+    Time<FnDecl>("FnDecl", nodes);
+    Time<ClassDecl>("ClassDecl", nodes);
+    Time<VarDecl>("VarDecl", nodes);
+    Time<Expr>("Expr", nodes);
+    Time<LValue>("LValue", nodes);
+    Time<FieldAccess>("FieldAccess", nodes);
+    Time<NamedType>("NamedType", nodes);
+    Time<ArrayType>("ArrayType", nodes);
+    Time<LoopStmt>("LoopStmt", nodes);
+    return 0;
+}
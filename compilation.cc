@@ -0,0 +1,321 @@
+/* File: compilation.cc
+ * --------------------
+ * Implementation of the Compilation class and of compiling several
+ * files on threads.
+ */
+
+#include "compilation.h"
+#include "utility.h" // for PrintDebug(), GetOption(), Failure()
+#include "parser.h"  // for yyparse()
+#include "ast_passes.h"
+#include "ast_image.h"
+#include "ast_dump.h"
+#include "list.h"
+#include "allocations.h"
+#include <stdio.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static thread_local Compilation *current;
+
+Compilation::Compilation(const char *p)
+  : path(p), numErrors(0), checked(false), errors(&cerr), output(stdout), program(NULL),
+    image(NULL), imageLength(0), stats(), treeStats()
+{
+}
+
+Compilation::~Compilation()
+{
+    if (image)
+        UnmapSourceFile(image, imageLength);
+}
+
+Compilation *Compilation::Current()
+{
+    return current;
+}
+
+
+/* Class: PhaseTimer
+ * -----------------
+ * Makes a compilation the current one on this thread for as long as one
+ * of its phases runs, then records the phase's wall time and how much
+ * it allocated.
+ */
+class PhaseTimer
+{
+  public:
+    PhaseTimer(Compilation *c, Compilation::Phase p)
+      : comp(c), phase(p), outer(current),
+        outerAnnotations(Annotations::current), before(ThreadAllocations()),
+        start(chrono::steady_clock::now())
+    {
+        current = comp;
+        Annotations::current = &comp->annotations;
+    }
+
+    ~PhaseTimer()
+    {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        AllocationCount after = ThreadAllocations();
+        PhaseStats &stats = comp->stats[phase];
+        stats.runs++;
+        stats.seconds = elapsed.count();
+        stats.allocations = after.count - before.count;
+        stats.bytes = after.bytes - before.bytes;
+        current = outer;
+        Annotations::current = outerAnnotations;
+    }
+
+  private:
+    Compilation *comp;
+    Compilation::Phase phase;
+    Compilation *outer;
+    Annotations *outerAnnotations;
+    AllocationCount before;
+    chrono::steady_clock::time_point start;
+};
+
+bool Compilation::Load()
+{
+    PhaseTimer timer(this, LoadPhase);
+    bool loaded = source.Load(path, GetOption("bounded-memory") != NULL);
+    if (loaded)
+        PrintDebug("lex", "Loaded %s (%lu bytes%s)", path ? path : "stdin",
+                   (unsigned long)source.Length(),
+                   source.IsReadOnly() ? ", read-only" : "");
+    return loaded;
+}
+
+Program *Compilation::Parse()
+{
+    PhaseTimer timer(this, ParsePhase);
+    program = NULL;
+    scanner.Init(&source);
+    yyparse(this);
+    return program;
+}
+
+void Compilation::CollectDeclarations()
+{
+    PhaseTimer timer(this, DeclarePhase);
+    if (program)
+        program->CollectDeclarations();
+}
+
+void Compilation::Annotate()
+{
+    PhaseTimer timer(this, AnnotatePhase);
+    if (!program)
+        return;
+    AssignLevels levels;
+    FindContexts contexts;
+    BuildScopes scopes;
+    BindNames bindings;
+    if (GetOption("phase-stats")) {
+        treeStats = TreeStats();
+        CountNodes counts(&treeStats);
+        WalkFused(program, levels, contexts, scopes, bindings, counts);
+    } else {
+        WalkFused(program, levels, contexts, scopes, bindings);
+    }
+}
+
+void Compilation::Check()
+{
+    if (stats[AnnotatePhase].runs == 0)
+        Annotate();
+    PhaseTimer timer(this, CheckPhase);
+    if (program)
+        program->Check();
+    checked = true;
+}
+
+void Compilation::Dump()
+{
+    // A checked tree loaded with its errors was not annotated, and the
+    // dump looks up names.
+    if (checked && stats[AnnotatePhase].runs == 0)
+        Annotate();
+    PhaseTimer timer(this, DumpPhase);
+    if (!program)
+        return;
+    DumpFormat format;
+    const char *name = GetOption("dump-ast");
+    if (name && ParseDumpFormat(name, &format)) {
+        fflush(output);
+        DumpTree(program, format, checked, fileno(output));
+    } else {
+        Node::PrintTo(output);
+        program->Print(0);
+        Node::PrintTo(NULL);
+    }
+}
+
+bool Compilation::EmitImage(const char *imagePath)
+{
+    PhaseTimer timer(this, EmitPhase);
+    return program && AstImage::Write(this, imagePath);
+}
+
+bool Compilation::LoadImage(const char *imagePath)
+{
+    PhaseTimer timer(this, LoadPhase);
+    Assert(image == NULL);
+    image = MapSourceFile(imagePath, &imageLength);
+    if (!image)
+        return false;
+    int errorsBefore;
+    program = AstImage::Read(this, image, imageLength, &checked, &errorsBefore);
+    if (!program)
+        return false;
+    numErrors = errorsBefore;
+    PrintDebug("lex", "Loaded %s (%lu bytes of source)", imagePath,
+               (unsigned long)source.Length());
+    return true;
+}
+
+bool Compilation::Run()
+{
+    if (GetOption("load-ast")) {
+        if (!LoadImage(path))
+            return false;
+    } else {
+        if (!Load())
+            return false;
+        Parse();
+    }
+    // if no errors, advance to next phase
+    if (program && numErrors == 0) {
+        CollectDeclarations();
+        Annotate();
+        if (!checked)
+            Check();
+    }
+    if (program && GetOption("dump-ast"))
+        Dump();
+    const char *emit = GetOption("emit-ast");
+    if (program && emit) {
+        string imagePath = *emit ? emit : string(path ? path : "stdin") + ".dast";
+        if (!EmitImage(imagePath.c_str()))
+            *errors << "*** Cannot write AST image '" << imagePath << "'" << endl;
+    }
+    return true;
+}
+
+const char *Compilation::PhaseName(Phase phase)
+{
+    static const char *names[NumPhases] = { "load", "parse", "declare", "annotate", "check",
+                                              "dump", "emit" };
+    return names[phase];
+}
+
+void Compilation::PrintStats(ostream &out) const
+{
+    char line[128];
+    snprintf(line, sizeof(line), "%-8s %10s %12s %14s\n", "phase", "ms", "allocations", "bytes");
+    out << line;
+    for (int p = 0; p < NumPhases; p++) {
+        if (stats[p].runs == 0)
+            continue;
+        snprintf(line, sizeof(line), "%-8s %10.3f %12lu %14lu\n", PhaseName((Phase)p),
+                 stats[p].seconds * 1000, stats[p].allocations, stats[p].bytes);
+        out << line;
+    }
+    if (treeStats.nodes > 0) {
+        snprintf(line, sizeof(line), "tree: %d nodes (%d declarations, %d statements, "
+                 "%d expressions), %d deep\n", treeStats.nodes, treeStats.decls,
+                 treeStats.stmts, treeStats.exprs, treeStats.depth);
+        out << line;
+    }
+}
+
+
+/* Writes a file's dump, collected in the temporary file dump, to
+ * stdout under its name, and closes the temporary file.
+ */
+static void WriteDump(FILE *dump, const char *path)
+{
+    printf("\n*** In %s:\n", path);
+    rewind(dump);
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), dump)) > 0)
+        fwrite(buf, 1, n, stdout);
+    fclose(dump);
+}
+
+int CompileFiles(List<const char*> *paths, int jobs)
+{
+    int n = paths->NumElements();
+    bool printStats = GetOption("phase-stats") != NULL;
+    bool dump = GetOption("dump-ast") != NULL;
+    vector<ostringstream> messages(n), phaseStats(n);
+    vector<FILE *> dumps(n);
+    vector<char> loaded(n); // not vector<bool>, which threads cannot share
+    vector<int> numErrors(n);
+
+    // Each worker takes the next file that nobody has started yet. Once
+    // it is done, all that is wanted of it is kept and the Compilation,
+    // tree and all, is freed, so only the files in progress take memory.
+    atomic<int> next(0);
+    auto work = [&]() {
+        for (int i; (i = next++) < n; ) {
+            Compilation *comp = new Compilation(paths->Nth(i));
+            comp->SetErrorStream(&messages[i]);
+            if (dump) {
+                if ((dumps[i] = tmpfile()) == NULL)
+                    Failure("Could not make a temporary file for the tree of %s",
+                            paths->Nth(i));
+                comp->SetOutput(dumps[i]);
+            }
+            loaded[i] = comp->Run();
+            numErrors[i] = comp->NumErrors();
+            if (printStats)
+                comp->PrintStats(phaseStats[i]);
+            delete comp;
+        }
+    };
+    if (jobs < 1)
+        jobs = 1;
+    if (jobs > n)
+        jobs = n;
+    vector<thread> workers;
+    for (int j = 1; j < jobs; j++)
+        workers.push_back(thread(work));
+    work();
+    for (size_t j = 0; j < workers.size(); j++)
+        workers[j].join();
+
+    int status = 0;
+    for (int i = 0; i < n; i++) {
+        if (dumps[i]) {
+            if (loaded[i])
+                WriteDump(dumps[i], paths->Nth(i));
+            else
+                fclose(dumps[i]);
+        }
+        if (!loaded[i]) {
+            cerr << "*** Cannot open source file '" << paths->Nth(i) << "'" << endl;
+            status = 2;
+            continue;
+        }
+        if (numErrors[i] > 0) {
+            cerr << endl << "*** In " << paths->Nth(i) << ":" << endl << messages[i].str();
+            if (status == 0)
+                status = -1;
+        }
+        if (printStats) {
+            cerr << endl << "*** Phases of " << paths->Nth(i) << ":" << endl;
+            cerr << phaseStats[i].str();
+        }
+    }
+    return status;
+}
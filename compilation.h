@@ -0,0 +1,166 @@
+/* File: compilation.h
+ * -------------------
+ * This file declares the Compilation class, which holds everything that
+ * belongs to compiling one source file: its text and line table, its
+ * scanner, its error count and the tables of declared names. Nothing in
+ * the front end keeps per-file state anywhere else, so several
+ * compilations can run at once, each on its own thread.
+ *
+ * The parser and scanner are handed their Compilation explicitly. Code
+ * deep in the AST that reports errors or consults the symbol tables
+ * finds it through Compilation::Current() instead, which is set for the
+ * running thread while one of the phases below is in progress.
+ *
+ * Compiling is done in phases: Load() the text, Parse() it into a tree,
+ * CollectDeclarations() into the symbol tables, Annotate() the tree with
+ * what the checks need to know about where each node is, Check() it and,
+ * if asked, Dump() it. EmitImage() saves the tree in a file that
+ * LoadImage() rebuilds it from (see ast_image.h), in place of Load()
+ * and Parse(). Run() does what dcc does, but a tool can call
+ * them itself, time them separately, repeat one, or leave some out. The
+ * tree is made in the Compilation's arena and stays alive as long as the
+ * Compilation does; deleting the Compilation frees it all at once. Each phase records
+ * its wall time and what it allocated (see allocations.h) in a
+ * PhaseStats, which --phase-stats prints.
+ */
+
+#ifndef _H_compilation
+#define _H_compilation
+
+#include <stdio.h>
+#include <ostream>
+#include "source.h"
+#include "scanner.h"
+#include "symbols.h"
+#include "annotations.h"
+#include "arena.h"
+#include "list.h"
+
+class Program;
+
+struct PhaseStats {
+    int runs;                   // 0 if the phase has not been run
+    double seconds;             // wall time of the last run
+    unsigned long allocations;  // what the last run allocated
+    unsigned long bytes;
+};
+
+struct TreeStats {              // filled in by CountNodes (see ast_passes.h)
+    int nodes;
+    int decls, stmts, exprs;
+    int depth;                  // nodes on the longest path from the root
+};
+
+class Compilation
+{
+  public:
+    enum Phase { LoadPhase, ParsePhase, DeclarePhase, AnnotatePhase, CheckPhase,
+                 DumpPhase, EmitPhase, NumPhases };
+
+    Compilation(const char *path); // NULL means stdin
+    ~Compilation();
+
+    // Reads the source file. Returns false if it could not be read.
+    bool Load();
+
+    // Scans and parses the text Load() read and returns the tree, which
+    // is also kept for the later phases; NULL if the parse failed.
+    Program *Parse();
+
+    // Enters the program's classes, functions and interfaces in the
+    // symbol tables.
+    void CollectDeclarations();
+
+    // Runs the visitors of ast_passes.h over the tree in one walk; with
+    // --phase-stats, counting its nodes is one of them.
+    void Annotate();
+
+    // Runs the semantic checks over the tree, reporting what it finds.
+    // Annotates the tree first if that has not been done.
+    void Check();
+
+    // Prints the tree on the output file: with Print(), or as JSON or
+    // text for other tools with --dump-ast=json or =text (see ast_dump.h).
+    void Dump();
+
+    // Writes the tree to an AST image at imagePath. Returns false if it
+    // could not be written.
+    bool EmitImage(const char *imagePath);
+
+    // Rebuilds the tree, the source text and the error count from the
+    // AST image at imagePath, which stays mapped while the Compilation
+    // lives. Returns false if it is not an image that can be read.
+    bool LoadImage(const char *imagePath);
+
+    // Does what dcc does: loads and parses the file and, if that went
+    // without errors, collects the declarations and checks the tree;
+    // with --dump-ast it then prints the tree. With --load-ast the tree
+    // comes from the image at path instead, and is only checked if it
+    // was saved unchecked; with --emit-ast it is saved at the end.
+    // Returns false if the file could not be read.
+    bool Run();
+
+    Program *GetProgram() const { return program; }
+    void SetProgram(Program *p) { program = p; } // by the parser
+
+    const PhaseStats &GetStats(Phase phase) const { return stats[phase]; }
+    static const char *PhaseName(Phase phase);
+    const TreeStats &GetTreeStats() const { return treeStats; }
+    // Writes a table of the phases that have been run, and what the
+    // tree was found to hold if its nodes were counted.
+    void PrintStats(std::ostream &out) const;
+
+    const char *GetPath() const { return path; }
+    int NumErrors() const { return numErrors; }
+    bool WasChecked() const { return checked; } // or loaded checked
+
+    // Where error messages go; cerr unless set otherwise.
+    std::ostream &ErrorStream() { return *errors; }
+    void SetErrorStream(std::ostream *s) { errors = s; }
+
+    // Where Dump() prints the tree; stdout unless set otherwise.
+    FILE *Output() const { return output; }
+    void SetOutput(FILE *f) { output = f; }
+
+    // The compilation running on this thread, or NULL.
+    static Compilation *Current();
+
+    Arena arena;      // holds the tree; goes last, with everything in it
+    SourceText source;
+    Scanner scanner;
+    SymbolTables symbols;
+    Annotations annotations; // the types the checks give the expressions
+
+  private:
+    friend class ReportError; // counts the errors
+    friend class PhaseTimer;  // fills in stats
+    const char *path;
+    int numErrors;
+    bool checked;
+    std::ostream *errors;
+    FILE *output;
+    Program *program;
+    char *image;      // the mapped AST image, if loaded from one
+    size_t imageLength;
+    PhaseStats stats[NumPhases];
+    TreeStats treeStats;
+};
+
+
+/* Function: CompileFiles()
+ * Usage: status = CompileFiles(paths, jobs);
+ * ------------------------------------------
+ * Compiles each of the files, up to jobs of them at a time on separate
+ * threads. Each file's error messages are collected as it is compiled
+ * and then written to cerr in the order the files were given, so the
+ * output does not depend on how the threads were scheduled. Returns
+ * the exit status for dcc: 2 if a file could not be read, -1 if there
+ * were errors and 0 otherwise. With --phase-stats, each file's phase
+ * statistics follow its messages. With --dump-ast, each file's tree is
+ * likewise collected (in a temporary file, as it can be far bigger than
+ * the messages) and written to stdout in the same order, under the
+ * file's name.
+ */
+int CompileFiles(List<const char*> *paths, int jobs);
+
+#endif
@@ -12,32 +12,37 @@
 using namespace std;
 
 #include "scanner.h" // for GetLineNumbered
+#include "compilation.h"
 
 
-int ReportError::numErrors = 0;
+int ReportError::NumErrors() {
+    return Compilation::Current()->numErrors;
+}
 
 void ReportError::UnderlineErrorInLine(const char *line, const yyltype *pos) {
     if (!line) return;
-    cerr << line << endl;
+    ostream &out = Compilation::Current()->ErrorStream();
+    out << line << endl;
     for (int i = 1; i <= pos->last_column; i++)
-        cerr << (i >= pos->first_column ? '^' : ' ');
-    cerr << endl;
+        out << (i >= pos->first_column ? '^' : ' ');
+    out << endl;
 }
 
  
 void ReportError::EmitError(yyltype *loc, string msg) {
-    numErrors++;
+    Compilation::Current()->numErrors++;
     OutputError(loc, msg);
 }
 
 void ReportError::OutputError(const yyltype *loc, string msg) {
+    ostream &out = Compilation::Current()->ErrorStream();
     fflush(stdout); // make sure any buffered text has been output
     if (loc) {
-        cerr << endl << "*** Error line " << loc->first_line << "." << endl;
+        out << endl << "*** Error line " << loc->first_line << "." << endl;
         UnderlineErrorInLine(GetLineNumbered(loc->first_line), loc);
     } else
-        cerr << endl << "*** Error." << endl;
-    cerr << "*** " << msg << endl << endl;
+        out << endl << "*** Error." << endl;
+    out << "*** " << msg << endl << endl;
 }
 
 void ReportError::Formatted(yyltype *loc, const char *format, ...) {
@@ -50,12 +55,25 @@ void ReportError::Formatted(yyltype *loc, const char *format, ...) {
     EmitError(loc, errbuf);
 }
 
+void ReportError::Formatted(SourceLocation loc, const char *format, ...) {
+    va_list args;
+    char errbuf[2048];
+    
+    va_start(args, format);
+    vsprintf(errbuf,format, args);
+    va_end(args);
+    yyltype decoded;
+    if (loc)
+        decoded = loc.Decode();
+    EmitError(loc ? &decoded : NULL, errbuf);
+}
+
 void ReportError::UntermComment() {
     EmitError(NULL, "Input ends with unterminated comment");
 }
 
 void ReportError::InvalidDirective(int linenum) {
-    yyltype ll = {0, linenum, 0, 0};
+    yyltype ll = {linenum, 0, 0, 0};
     EmitError(&ll, "Invalid # directive");
 }
 
@@ -86,6 +104,6 @@ void ReportError::UnrecogChar(yyltype *loc, char ch) {
  * then call ReportError::Formatted yourself with a more descriptive 
  * message.
  */
-void yyerror(const char *msg) {
-    ReportError::Formatted(&yylloc, "%s", msg);
+void yyerror(yyltype *loc, Compilation *comp, const char *msg) {
+    ReportError::Formatted(loc, "%s", msg);
 }
@@ -27,14 +27,21 @@ using std::string;
  * on this class are static, thus you can invoke methods directly via
  * the class name, e.g.
  *
- *    if (missingEnd) ReportError::UntermString(&yylloc, str);
+ *    if (missingEnd) ReportError::UntermString(yylloc, str);
  *
  * For some methods, the first argument is the pointer to the location
  * structure that identifies where the problem is (usually this is the
- * location of the offending token). You can pass NULL for the argument
- * if there is no appropriate position to point out. For other methods,
+ * location of the offending token). There is no global yylloc: in the
+ * scanner rules, yylloc is the pointer the parser of this compilation
+ * passed in (see scanner.h). You can pass NULL for the argument if
+ * there is no appropriate position to point out. For other methods,
  * location is accessed by messaging the node in error which is passed
- * as an argument. You cannot pass NULL for these arguments.
+ * as an argument. You cannot pass NULL for these arguments. A node
+ * only keeps a SourceLocation, which Formatted() takes as it is:
+ *
+ *    ReportError::Formatted(node->GetLocation(), "...", ...);
+ *
+ * The messages count against the compilation running on this thread.
  */
 
 
@@ -56,17 +63,19 @@ class ReportError
 
   // Generic method to report a printf-style error message
   static void Formatted(yyltype *loc, const char *format, ...);
+  // The same for a node's location, decoded for the message
+  static void Formatted(SourceLocation loc, const char *format, ...);
 
 
-  // Returns number of error messages printed
-  static int NumErrors() { return numErrors; }
+  // Returns number of error messages printed for the compilation
+  // running on this thread (see compilation.h)
+  static int NumErrors();
   
  private:
 
   static void UnderlineErrorInLine(const char *line, const yyltype *pos);
   static void EmitError(yyltype *loc, string msg);
   static void OutputError(const yyltype *loc, string msg);
-  static int numErrors;
   
 };
 
@@ -0,0 +1,413 @@
+/* File: hand_scanner.cc
+ * ---------------------
+ * A hand-written scanner for Decaf. It produces exactly the same tokens,
+ * yylval values and yylloc positions as the flex scanner in scanner.l,
+ * which remains the reference; run both with -d tokens to compare them.
+ *
+ * The text is scanned in place, and never written to, so it can be a
+ * read-only mapping whose pages we release as we pass them (see
+ * SourceText::ReleaseBefore() in source.h). The long runs that make up
+ * most of a source file (spaces, comment bodies and string literal bodies) are
+ * skipped 16 bytes at a time with SSE2, or 32 at a time when compiled
+ * with AVX2 enabled (-mavx2). Identifiers are checked against the
+ * keywords with a perfect hash, so a lookup is one probe and one memcmp.
+ *
+ * To match flex exactly we also reproduce its bookkeeping: every match
+ * (including whitespace and each character inside a block comment)
+ * updates yylloc the way DoBeforeEachAction() does, since the location
+ * of whatever was matched last is what the parser sees at end of file.
+ *
+ * All of the scanner's state is in the HandScanner object; the keyword
+ * table is shared, but it is built before main() and only read after.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include "hand_scanner.h"
+#include "scanner.h"
+#include "utility.h" // for Failure()
+#include "errors.h"
+#include "parser.h" // for token codes, YYSTYPE
+#include "source.h"
+#include "intern.h" // for Intern()
+#include "arena.h"  // for ArenaStrndup()
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+
+void HandScanner::Start(SourceText *s)
+{
+    source = s;
+    text = cur = s->Text();
+    end = text + s->Length();
+    curLineNum = 1;
+    curColNum = 1;
+}
+
+
+/* Character classes
+ * -----------------
+ * Plain ASCII tests, as flex's character classes are.
+ */
+static inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+static inline bool IsAlpha(char c) { return (c | 0x20) >= 'a' && (c | 0x20) <= 'z'; }
+static inline bool IsIdentChar(char c) { return IsAlpha(c) || IsDigit(c) || c == '_'; }
+static inline bool IsHexDigit(char c)
+{
+    return IsDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+
+/* Bulk skipping
+ * -------------
+ * SpanOf() returns the first position in [p, limit) that is not c, and
+ * FindAny() the first that is a, b or c; both return limit if there is
+ * none. Wide loads are only issued while a whole vector fits before
+ * limit, and the rest is finished a byte at a time.
+ */
+static const char *SpanOf(const char *p, const char *limit, char c)
+{
+#if defined(__AVX2__)
+    const __m256i cc = _mm256_set1_epi8(c);
+    for (; p + 32 <= limit; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        unsigned mask = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cc));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    const __m128i cc = _mm_set1_epi8(c);
+    for (; p + 16 <= limit; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        unsigned mask = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, cc)) & 0xFFFF;
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p < limit && *p == c)
+        p++;
+    return p;
+}
+
+static const char *FindAny(const char *p, const char *limit, char a, char b, char c)
+{
+#if defined(__AVX2__)
+    const __m256i aa = _mm256_set1_epi8(a), bb = _mm256_set1_epi8(b),
+                  cc = _mm256_set1_epi8(c);
+    for (; p + 32 <= limit; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, aa),
+                      _mm256_or_si256(_mm256_cmpeq_epi8(v, bb), _mm256_cmpeq_epi8(v, cc)));
+        unsigned mask = _mm256_movemask_epi8(hit);
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#elif defined(__SSE2__)
+    const __m128i aa = _mm_set1_epi8(a), bb = _mm_set1_epi8(b), cc = _mm_set1_epi8(c);
+    for (; p + 16 <= limit; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, aa),
+                      _mm_or_si128(_mm_cmpeq_epi8(v, bb), _mm_cmpeq_epi8(v, cc)));
+        unsigned mask = _mm_movemask_epi8(hit);
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+#endif
+    while (p < limit && *p != a && *p != b && *p != c)
+        p++;
+    return p;
+}
+
+
+/* Keywords
+ * --------
+ * A perfect hash on the first, second and last characters puts each of
+ * the 27 reserved words in its own slot of a 64-entry table. An
+ * identifier is a keyword only if the word in its slot matches exactly.
+ */
+struct Keyword {
+    const char *word;
+    int length;
+    int token;
+};
+
+static Keyword keywords[64];
+static const int MinKeywordLen = 2, MaxKeywordLen = 11;
+
+static inline unsigned KeywordSlot(const char *s, int len)
+{
+    return ((unsigned char)s[0] * 31 + (unsigned char)s[1] +
+            (unsigned char)s[len - 1] * 6) & 63;
+}
+
+static bool BuildKeywordTable()
+{
+    static const Keyword words[] = {
+        {"void", 4, T_Void}, {"int", 3, T_Int}, {"double", 6, T_Double},
+        {"bool", 4, T_Bool}, {"string", 6, T_String}, {"null", 4, T_Null},
+        {"class", 5, T_Class}, {"extends", 7, T_Extends}, {"this", 4, T_This},
+        {"interface", 9, T_Interface}, {"implements", 10, T_Implements},
+        {"while", 5, T_While}, {"for", 3, T_For}, {"if", 2, T_If},
+        {"else", 4, T_Else}, {"return", 6, T_Return}, {"break", 5, T_Break},
+        {"New", 3, T_New}, {"NewArray", 8, T_NewArray}, {"Print", 5, T_Print},
+        {"ReadInteger", 11, T_ReadInteger}, {"ReadLine", 8, T_ReadLine},
+        {"switch", 6, T_Switch}, {"case", 4, T_Case}, {"default", 7, T_Default},
+        {"true", 4, T_BoolConstant}, {"false", 5, T_BoolConstant},
+    };
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        unsigned slot = KeywordSlot(words[i].word, words[i].length);
+        if (keywords[slot].word)
+            Failure("Keyword hash collision on '%s'", words[i].word);
+        keywords[slot] = words[i];
+    }
+    return true;
+}
+
+static bool keywordsBuilt = BuildKeywordTable();
+
+/* Returns the token code for the word, or 0 if it is not a keyword. */
+static inline int LookupKeyword(const char *s, int len)
+{
+    if (len < MinKeywordLen || len > MaxKeywordLen)
+        return 0;
+    const Keyword &k = keywords[KeywordSlot(s, len)];
+    return (k.length == len && memcmp(k.word, s, len) == 0) ? k.token : 0;
+}
+
+
+/* Matching
+ * --------
+ * Match() consumes len characters as a single match, recording its
+ * location exactly as DoBeforeEachAction() does for flex. MatchEach()
+ * consumes len characters that flex would match one at a time (as it
+ * does inside a block comment), so only the last one ends up in lloc->
+ */
+inline void HandScanner::Match(int len)
+{
+    lloc->first_line = lloc->last_line = curLineNum;
+    lloc->first_column = curColNum;
+    lloc->last_column = curColNum + len - 1;
+    lloc->first_offset = cur - text;
+    lloc->last_offset = cur - text + len - 1;
+    curColNum += len;
+    cur += len;
+}
+
+inline void HandScanner::MatchEach(int len)
+{
+    if (len == 0)
+        return;
+    curColNum += len - 1;
+    cur += len - 1;
+    Match(1);
+}
+
+inline void HandScanner::MatchNewline()
+{
+    Match(1);
+    curLineNum++;
+    curColNum = 1;
+    source->AddLineStart(cur - text);
+    source->ReleaseBefore(cur - text);
+}
+
+inline void HandScanner::MatchTab()
+{
+    Match(1);
+    curColNum += (TAB_SIZE - (curColNum - 1) % TAB_SIZE) % TAB_SIZE;
+}
+
+inline const char *HandScanner::Lexeme(const char *start, int len)
+{
+    lexeme.assign(start, len);
+    return lexeme.c_str();
+}
+
+/* Skips the body of a block comment after the opening slash-star.
+ * Returns false if the input ends before the comment does.
+ */
+bool HandScanner::SkipBlockComment()
+{
+    for (;;) {
+        const char *stop = FindAny(cur, end, '*', '\n', '\t');
+        MatchEach(stop - cur);
+        if (cur == end)
+            return false;
+        if (*cur == '\n')
+            MatchNewline();
+        else if (*cur == '\t')
+            MatchTab();
+        else if (cur[1] == '/') {
+            Match(2);
+            return true;
+        } else
+            Match(1);
+    }
+}
+
+/* Scans a number starting at cur, which is a digit. */
+int HandScanner::ScanNumber()
+{
+    const char *p = cur;
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X') && IsHexDigit(p[2])) {
+        for (p += 2; IsHexDigit(*p); p++)
+            ;
+        int len = p - cur;
+        lval->integerConstant = strtol(Lexeme(cur, len), NULL, 16);
+        Match(len);
+        return T_IntConstant;
+    }
+
+    while (IsDigit(*p))
+        p++;
+    if (*p != '.') {
+        int len = p - cur;
+        lval->integerConstant = strtol(Lexeme(cur, len), NULL, 10);
+        Match(len);
+        return T_IntConstant;
+    }
+
+    for (p++; IsDigit(*p); p++)
+        ;
+    if (*p == 'E' || *p == 'e') { // exponent only counts if it has digits
+        const char *q = p + 1;
+        if (*q == '+' || *q == '-')
+            q++;
+        if (IsDigit(*q)) {
+            while (IsDigit(*q))
+                q++;
+            p = q;
+        }
+    }
+    int len = p - cur;
+    lval->doubleConstant = atof(Lexeme(cur, len));
+    Match(len);
+    return T_DoubleConstant;
+}
+
+/* Scans a string literal starting at cur, which is a double quote.
+ * Returns 0 after reporting an error if it is not closed on this line.
+ */
+int HandScanner::ScanString()
+{
+    const char *stop = FindAny(cur + 1, end, '"', '\n', '"');
+    if (stop < end && *stop == '"') {
+        int len = stop + 1 - cur;
+        lval->stringConstant = ArenaStrndup(cur, len);
+        for (const char *tab = cur; (tab = (const char *)memchr(tab, '\t', stop - tab)); tab++)
+            source->AddLiteralTab(tab - text);
+        Match(len);
+        return T_StringConstant;
+    }
+    int len = stop - cur;
+    const char *str = Lexeme(cur, len);
+    Match(len);
+    ReportError::UntermString(lloc, str);
+    return 0;
+}
+
+/* Scans an identifier or keyword starting at cur, which is a letter. */
+int HandScanner::ScanWord()
+{
+    const char *start = cur, *p = cur + 1;
+    while (IsIdentChar(*p))
+        p++;
+    int len = p - start;
+    int token = LookupKeyword(start, len);
+    Match(len);
+    if (token == T_BoolConstant)
+        lval->boolConstant = (start[0] == 't');
+    if (token != 0)
+        return token;
+
+    if (len > MaxIdentLen)
+        ReportError::LongIdentifier(lloc, Lexeme(start, len));
+    lval->identifier = Intern(start, len > MaxIdentLen ? MaxIdentLen : len);
+    return T_Identifier;
+}
+
+/* Matches an operator that is one character, or two if the next
+ * character is second.
+ */
+inline int HandScanner::Operator(int single, char second, int dbl)
+{
+    if (cur[1] == second) {
+        Match(2);
+        return dbl;
+    }
+    Match(1);
+    return single;
+}
+
+int HandScanner::Scan(YYSTYPE *lv, yyltype *ll)
+{
+    lval = lv;
+    lloc = ll;
+    while (cur < end) {
+        char c = *cur;
+        switch (c) {
+          case ' ':
+            Match(SpanOf(cur, end, ' ') - cur);
+            continue;
+          case '\t':
+            MatchTab();
+            continue;
+          case '\n':
+            MatchNewline();
+            continue;
+
+          case '/':
+            if (cur[1] == '*') {
+                Match(2);
+                if (!SkipBlockComment()) {
+                    ReportError::UntermComment();
+                    return 0;
+                }
+                continue;
+            }
+            if (cur[1] == '/') {
+                Match(FindAny(cur, end, '\n', '\n', '\n') - cur);
+                continue;
+            }
+            Match(1);
+            return '/';
+
+          case '"':
+            if (int token = ScanString())
+                return token;
+            continue;
+
+          case '<': return Operator('<', '=', T_LessEqual);
+          case '>': return Operator('>', '=', T_GreaterEqual);
+          case '=': return Operator('=', '=', T_Equal);
+          case '!': return Operator('!', '=', T_NotEqual);
+          case '+': return Operator('+', '+', T_Increm);
+          case '-': return Operator('-', '-', T_Decrem);
+          case '[': return Operator('[', ']', T_Dims);
+          case '&':
+          case '|':
+            if (cur[1] == c) {
+                Match(2);
+                return c == '&' ? T_And : T_Or;
+            }
+            break; // a lone & or | is not a Decaf character
+
+          case '*': case '%': case '.': case ',': case ';': case ':':
+          case '(': case ')': case ']': case '{': case '}':
+            Match(1);
+            return c;
+
+          default:
+            if (IsDigit(c))
+                return ScanNumber();
+            if (IsAlpha(c))
+                return ScanWord();
+            break;
+        }
+        Match(1);
+        ReportError::UnrecogChar(lloc, c);
+    }
+    return 0;
+}
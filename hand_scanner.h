@@ -0,0 +1,51 @@
+/* File: hand_scanner.h
+ * --------------------
+ * This file declares the hand-written scanner, one of the two scanner
+ * back ends (see scanner.h). Its state is a HandScanner object, so each
+ * compilation scans with its own.
+ */
+
+#ifndef _H_hand_scanner
+#define _H_hand_scanner
+
+#include <stddef.h>   // for size_t
+#include <string>
+#include "location.h"
+
+union YYSTYPE;
+class SourceText;
+
+class HandScanner
+{
+  public:
+    // Starts scanning the whole of source, whose text must be followed
+    // by two NULs. It is only read, so it may be a read-only mapping.
+    void Start(SourceText *source);
+
+    // Returns the next token, filling in *lval and *lloc just as the
+    // flex scanner would, or 0 at the end of the text.
+    int Scan(YYSTYPE *lval, yyltype *lloc);
+
+  private:
+    void Match(int len);
+    void MatchEach(int len);
+    void MatchNewline();
+    void MatchTab();
+    const char *Lexeme(const char *start, int len);
+    bool SkipBlockComment();
+    int ScanNumber();
+    int ScanString();
+    int ScanWord();
+    int Operator(int single, char second, int dbl);
+
+    SourceText *source;
+    const char *text;   // start of the program text
+    const char *cur;    // next character to scan
+    const char *end;    // one past the last character (a NUL follows)
+    int curLineNum, curColNum;
+    std::string lexeme; // NUL-terminated copy when one is needed
+    YYSTYPE *lval;      // where the current Scan() puts its results
+    yyltype *lloc;
+};
+
+#endif
@@ -2,7 +2,103 @@
  * ------------------
  * Implementation of Hashtable class.
  */
-   
+
+#include <algorithm>
+
+
+template <class Value> Hashtable<Value>::Hashtable()
+  : mask(7), numKeys(0), numEntries(0)
+{
+  slots = (Slot *)calloc(mask + 1, sizeof(Slot));
+}
+
+template <class Value> Hashtable<Value>::~Hashtable()
+{
+  for (uint32_t i = 0; i <= mask; i++) {
+    if (!slots[i].key)
+      continue;
+    free(slots[i].key);
+    for (Shadowed *s = slots[i].shadowed, *next; s; s = next) {
+      next = s->next;
+      delete s;
+    }
+  }
+  free(slots);
+}
+
+
+/* Hashtable::Hash
+ * ---------------
+ * FNV-1a, as for the name pool (see intern.cc).
+ */
+template <class Value> uint32_t Hashtable<Value>::Hash(const char *key)
+{
+  uint32_t h = 2166136261u;
+  for (; *key; key++)
+    h = (h ^ (unsigned char)*key) * 16777619u;
+  return h;
+}
+
+
+/* Hashtable::Find
+ * ---------------
+ * Returns the slot that holds key, or the empty slot where it belongs
+ * if it is not in the table.
+ */
+template <class Value> uint32_t Hashtable<Value>::Find(const char *key, uint32_t hash) const
+{
+  uint32_t i = hash & mask;
+  while (slots[i].key &&
+         (slots[i].hash != hash || strcmp(slots[i].key, key) != 0))
+    i = (i + 1) & mask;
+  return i;
+}
+
+
+/* Hashtable::Grow
+ * ---------------
+ * Doubles the number of slots and puts every key back in its place.
+ */
+template <class Value> void Hashtable<Value>::Grow()
+{
+  Slot *old = slots;
+  uint32_t oldSize = mask + 1;
+  mask = 2 * oldSize - 1;
+  slots = (Slot *)calloc(mask + 1, sizeof(Slot));
+  for (uint32_t i = 0; i < oldSize; i++) {
+    if (!old[i].key)
+      continue;
+    uint32_t j = old[i].hash & mask;
+    while (slots[j].key)
+      j = (j + 1) & mask;
+    slots[j] = old[i];
+  }
+  free(old);
+}
+
+
+/* Hashtable::Delete
+ * -----------------
+ * Empties slot i, whose key has no values left, and moves back the keys
+ * after it that would no longer be found past the gap.
+ */
+template <class Value> void Hashtable<Value>::Delete(uint32_t i)
+{
+  free(slots[i].key);
+  for (uint32_t j = (i + 1) & mask; slots[j].key; j = (j + 1) & mask) {
+    uint32_t home = slots[j].hash & mask;
+    // Slot j may move to i unless its home lies between them.
+    bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+    if (!between) {
+      slots[i] = slots[j];
+      i = j;
+    }
+  }
+  slots[i].key = NULL;
+  slots[i].shadowed = NULL;
+  numKeys--;
+}
+
 
 /* Hashtable::Enter
  * ----------------
@@ -13,13 +109,35 @@
  */
 template <class Value> void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite)
 {
-  Value prev;
-  if (overwrite && (prev = Lookup(key)))
-    Remove(key, prev);
-  mmap.insert(std::make_pair(strdup(key), val));
+  uint32_t hash = Hash(key);
+  uint32_t i = Find(key, hash);
+  if (overwrite && slots[i].key) {
+    Remove(key, slots[i].value);
+    i = Find(key, hash);
+  }
+  if (slots[i].key) {
+    Shadowed *s = new Shadowed;
+    s->value = slots[i].value;
+    s->next = slots[i].shadowed;
+    slots[i].shadowed = s;
+    slots[i].value = val;
+    numEntries++;
+    return;
+  }
+
+  if (2 * (uint32_t)(numKeys + 1) > mask + 1) {
+    Grow();
+    i = Find(key, hash);
+  }
+  slots[i].key = strdup(key);
+  slots[i].hash = hash;
+  slots[i].value = val;
+  slots[i].shadowed = NULL;
+  numKeys++;
+  numEntries++;
 }
 
- 
+
 /* Hashtable::Remove
  * -----------------
  * Removes a given key-value pair from table. If no such pair, no
@@ -27,19 +145,36 @@ template <class Value> void Hashtable<Value>::Enter(const char *key, Value val,
  */
 template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
 {
-  if (mmap.count(key) == 0) // no matches at all
+  uint32_t i = Find(key, Hash(key));
+  Slot &slot = slots[i];
+  if (!slot.key) // no matches at all
+    return;
+
+  // The oldest entry with the value goes, as it always has.
+  Shadowed **oldest = NULL;
+  for (Shadowed **link = &slot.shadowed; *link; link = &(*link)->next)
+    if ((*link)->value == val)
+      oldest = link;
+  if (oldest) {
+    Shadowed *s = *oldest;
+    *oldest = s->next;
+    delete s;
+    numEntries--;
     return;
+  }
 
-  typename std::multimap<const char *, Value>::iterator itr;
-  itr = mmap.find(key); // start at first occurrence
-  while (itr != mmap.upper_bound(key)) {
-    if (itr->second == val) { // iterate to find matching pair
-	mmap.erase(itr);
-	break;
+  if (slot.value == val) { // the newest goes, the one it shadows is back
+    numEntries--;
+    if (!slot.shadowed) {
+      Delete(i);
+      return;
     }
-    ++itr;
+    Shadowed *s = slot.shadowed;
+    slot.value = s->value;
+    slot.shadowed = s->next;
+    delete s;
   }
-} 
+}
 
 
 /* Hashtable::Lookup
@@ -47,23 +182,10 @@ template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
  * Returns the value earlier stored under key or NULL
  *if there is no matching entry
  */
-template <class Value> Value Hashtable<Value>::Lookup(const char *key) 
+template <class Value> Value Hashtable<Value>::Lookup(const char *key) const
 {
-  Value found = NULL;
-  
-  if (mmap.count(key) > 0) {
-    typename std::multimap<const char *, Value>::iterator cur, last, prev;
-    cur = mmap.find(key); // start at first occurrence
-    last = mmap.upper_bound(key);
-    while (cur != last) { // iterate to find last entered
-	prev = cur; 
-	if (++cur == mmap.upper_bound(key)) { // have to go one too far
-	  found = prev->second; // one before last was it
-	  break;
-	}
-    }
-  }
-  return found;
+  uint32_t i = Find(key, Hash(key));
+  return slots[i].key ? slots[i].value : NULL;
 }
 
 
@@ -72,18 +194,54 @@ template <class Value> Value Hashtable<Value>::Lookup(const char *key)
  */
 template <class Value> int Hashtable<Value>::NumEntries() const
 {
-  return mmap.size();
+  return numEntries;
 }
 
 
-
-/* Hashtable:GetIterator
- * ---------------------
- * Returns iterator which can be used to walk through all values in table.
+/* Hashtable:GetIterator, GetAlphabeticalIterator
+ * ----------------------------------------------
+ * Return iterators which can be used to walk through all values in
+ * table. The values of one key are given oldest first.
  */
-template <class Value> Iterator<Value> Hashtable<Value>::GetIterator() 
+template <class Value> Iterator<Value> Hashtable<Value>::GetIterator() const
 {
-  return Iterator<Value>(mmap);
+  Iterator<Value> iter;
+  iter.values.reserve(numEntries);
+  std::vector<Value> older;
+  for (uint32_t i = 0; i <= mask; i++) {
+    if (!slots[i].key)
+      continue;
+    older.clear();
+    for (Shadowed *s = slots[i].shadowed; s; s = s->next)
+      older.push_back(s->value);
+    iter.values.insert(iter.values.end(), older.rbegin(), older.rend());
+    iter.values.push_back(slots[i].value);
+  }
+  return iter;
+}
+
+template <class Value> Iterator<Value> Hashtable<Value>::GetAlphabeticalIterator() const
+{
+  std::vector<const Slot *> keys;
+  keys.reserve(numKeys);
+  for (uint32_t i = 0; i <= mask; i++)
+    if (slots[i].key)
+      keys.push_back(&slots[i]);
+  std::sort(keys.begin(), keys.end(), [](const Slot *a, const Slot *b) {
+    return strcmp(a->key, b->key) < 0;
+  });
+
+  Iterator<Value> iter;
+  iter.values.reserve(numEntries);
+  std::vector<Value> older;
+  for (const Slot *slot : keys) {
+    older.clear();
+    for (Shadowed *s = slot->shadowed; s; s = s->next)
+      older.push_back(s->value);
+    iter.values.insert(iter.values.end(), older.rbegin(), older.rend());
+    iter.values.push_back(slot->value);
+  }
+  return iter;
 }
 
 
@@ -94,6 +252,5 @@ template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
  */
 template <class Value> Value Iterator<Value>::GetNextValue()
 {
-  return (cur == end ? NULL : (*cur++).second);
+  return (next == values.size() ? NULL : values[next++]);
 }
-
@@ -1,10 +1,10 @@
 /* File: hashtable.h
  * -----------------
  * This is a simple table for storing values associated with a string
- * key, supporting simple operations for Enter and Lookup.  It is not
- * much more than a thin cover over the STL associative map container,
- * but hides the awkward C++ template syntax and provides a more
- * familiar interface.
+ * key, supporting simple operations for Enter and Lookup. It is an
+ * open-addressing hash table: each key's hash is worked out once, when
+ * it is entered, and kept with it, so a lookup compares hashes and only
+ * calls strcmp on a key whose hash matches.
  *
  * The keys are always strings, but the values can be of any type
  * (ok, that's actually kind of a fib, it expects the type to be
@@ -16,13 +16,15 @@
  * The same notation is used on the matching iterator for the table,
  * i.e. a Hashtable<char*> supports an Iterator<char*>.
  *
- * An iterator is provided for iterating over the entries in a table. 
- * The iterator walks through the values, one by one, in alphabetical
- * order by the key. Sample iteration usage:
+ * An iterator is provided for iterating over the entries in a table.
+ * GetIterator() walks through the values in no particular order, which
+ * costs nothing extra; GetAlphabeticalIterator() walks through them in
+ * alphabetical order by the key, which sorts the keys first. Sample
+ * iteration usage:
  *
  *       void PrintNames(Hashtable<Decl*> *table)
  *       {
- *          Iterator<Decl*> iter = table->GetIterator();
+ *          Iterator<Decl*> iter = table->GetAlphabeticalIterator();
  *          Decl *decl;
  *          while ((decl = iter.GetNextValue()) != NULL) {
  *               printf("%s\n", decl->GetName());
@@ -33,31 +35,49 @@
 #ifndef _H_hashtable
 #define _H_hashtable
 
-#include <map>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
-
-struct ltstr {
-  bool operator()(const char* s1, const char* s2) const
-  { return strcmp(s1, s2) < 0; }
-};
+#include <vector>
 
 
 template <class Value> class Iterator;
 
 template<class Value> class Hashtable {
 
-  private: 
-     std::multimap<const char*, Value, ltstr> mmap;
- 
+  private:
+     // A value that a later Enter() shadows is kept in a list hanging
+     // off its key's slot, newest first.
+     struct Shadowed {
+       Value value;
+       Shadowed *next;
+     };
+     struct Slot {
+       char *key;               // our own copy; NULL if the slot is empty
+       uint32_t hash;
+       Value value;             // the one Lookup() returns
+       Shadowed *shadowed;
+     };
+
+     Slot *slots;               // a power of two of them, at most half full
+     uint32_t mask;
+     int numKeys, numEntries;
+
+     static uint32_t Hash(const char *key);
+     uint32_t Find(const char *key, uint32_t hash) const;
+     void Grow();
+     void Delete(uint32_t i);
+
    public:
             // ctor creates a new empty hashtable
-     Hashtable() {}
+     Hashtable();
+     ~Hashtable();
 
            // Returns number of entries currently in table
      int NumEntries() const;
 
            // Associates value with key. If a previous entry for
-           // key exists, the bool parameter controls whether 
+           // key exists, the bool parameter controls whether
            // new value overwrites the previous (removing it from
            // from the table entirely) or just shadows it (keeps previous
            // and adds additional entry). The lastmost entered one for an
@@ -74,26 +94,34 @@ template<class Value> class Hashtable {
           // Returns value stored under key or NULL if no match.
           // If more than one value for key (ie shadow feature was
           // used during Enter), returns the lastmost entered one.
-     Value Lookup(const char *key);
+     Value Lookup(const char *key) const;
 
           // Returns an Iterator object (see below) that can be used to
-          // visit each value in the table in alphabetical order.
-     Iterator<Value> GetIterator();
+          // visit each value in the table, in no particular order.
+     Iterator<Value> GetIterator() const;
+
+          // The same, but visiting the values in alphabetical order
+          // by key, and the values of one key in the order entered.
+     Iterator<Value> GetAlphabeticalIterator() const;
 
+  private:
+     Hashtable(const Hashtable &);            // not copied
+     Hashtable &operator=(const Hashtable &);
 };
 
 
 /* Don't worry too much about how the Iterator is implemented, see
  * sample usage above for how to iterate over a hashtable using an
- * iterator.
+ * iterator. It holds its own list of the values, so changing the
+ * table does not disturb an iteration already under way.
  */
 template<class Value> class Iterator {
   friend class Hashtable<Value>;
 
   private:
-    typename std::multimap<const char*, Value , ltstr>::iterator cur, end;
-    Iterator(std::multimap<const char*, Value, ltstr>& t)
-      : cur(t.begin()), end(t.end()) {}
+    std::vector<Value> values;
+    size_t next;
+    Iterator() : next(0) {}
 
   public:
          // Returns current value and advances iterator to next.
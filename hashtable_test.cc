@@ -0,0 +1,231 @@
+/* File: hashtable_test.cc
+ * -----------------------
+ * A program of its own (make hashtable_test) that checks Hashtable
+ * against the table it replaced, a std::multimap from each key to its
+ * values, kept here as ReferenceTable. Run with no arguments, it does
+ * random Enter(), Remove() and Lookup() calls on both, with few keys so
+ * that values shadow each other often, and stops at the first answer
+ * that differs. Run with --bench, it times the two instead.
+ */
+
+#include "hashtable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/* Class: ReferenceTable
+ * ---------------------
+ * The multimap table: the values of a key are kept in the order they
+ * were entered, so the last one is the one a lookup finds, and Remove()
+ * takes out the first that matches.
+ */
+template <class Value> class ReferenceTable
+{
+  public:
+    void Enter(const char *key, Value value, bool overwrite = true)
+    {
+        Value prev;
+        if (overwrite && (prev = Lookup(key)) != NULL)
+            Remove(key, prev);
+        values.insert(std::make_pair(std::string(key), value));
+    }
+
+    void Remove(const char *key, Value value)
+    {
+        typename Map::iterator i = values.lower_bound(key);
+        for (; i != values.upper_bound(key); ++i)
+            if (i->second == value) {
+                values.erase(i);
+                return;
+            }
+    }
+
+    Value Lookup(const char *key) const
+    {
+        typename Map::const_iterator last = values.upper_bound(key);
+        if (last == values.begin() || (--last)->first != key)
+            return NULL;
+        return last->second;
+    }
+
+    int NumEntries() const { return values.size(); }
+
+    // All the values, alphabetically by key and then in the order they
+    // were entered.
+    std::vector<Value> Values() const
+    {
+        std::vector<Value> all;
+        for (typename Map::const_iterator i = values.begin(); i != values.end(); ++i)
+            all.push_back(i->second);
+        return all;
+    }
+
+  private:
+    typedef std::multimap<std::string, Value> Map;
+    Map values;
+};
+
+template <class Value> static std::vector<Value> Drain(Iterator<Value> iter)
+{
+    std::vector<Value> all;
+    Value value;
+    while ((value = iter.GetNextValue()) != NULL)
+        all.push_back(value);
+    return all;
+}
+
+/* Compares everything the two tables tell about themselves. Returns a
+ * description of the first difference, or NULL if there is none.
+ */
+static const char *Compare(const Hashtable<long *> &table,
+                           const ReferenceTable<long *> &reference,
+                           const std::vector<std::string> &keys)
+{
+    if (table.NumEntries() != reference.NumEntries())
+        return "NumEntries()";
+    for (size_t i = 0; i < keys.size(); i++)
+        if (table.Lookup(keys[i].c_str()) != reference.Lookup(keys[i].c_str()))
+            return "Lookup()";
+    std::vector<long *> expected = reference.Values();
+    if (Drain(table.GetAlphabeticalIterator()) != expected)
+        return "GetAlphabeticalIterator()";
+    std::vector<long *> unordered = Drain(table.GetIterator());
+    std::sort(unordered.begin(), unordered.end());
+    std::sort(expected.begin(), expected.end());
+    if (unordered != expected)
+        return "GetIterator()";
+    return NULL;
+}
+
+static int RandomTest()
+{
+    srand(1);
+    for (int round = 0; round < 500; round++) {
+        Hashtable<long *> table;
+        ReferenceTable<long *> reference;
+        std::vector<std::string> keys;
+        int numKeys = 1 + rand() % (round % 2 ? 8 : 300);
+        for (int i = 0; i < numKeys; i++) {
+            char key[32];
+            snprintf(key, sizeof(key), "k%d", rand() % 100000);
+            keys.push_back(key);
+        }
+        for (int op = 0; op < 4000; op++) {
+            const char *key = keys[rand() % numKeys].c_str();
+            // Few values, so that one is often entered twice under a key.
+            long *value = (long *)(size_t)(8 * (1 + rand() % 6));
+            switch (rand() % 4) {
+              case 0:
+                table.Enter(key, value);
+                reference.Enter(key, value);
+                break;
+              case 1:
+                table.Enter(key, value, false);
+                reference.Enter(key, value, false);
+                break;
+              case 2:
+                table.Remove(key, value);
+                reference.Remove(key, value);
+                break;
+              default:
+                break;
+            }
+            const char *differs = op % 100 == 99
+                ? Compare(table, reference, keys)
+                : table.Lookup(key) != reference.Lookup(key) ? "Lookup()" : NULL;
+            if (differs) {
+                printf("%s differs in round %d after %d operations\n", differs, round, op + 1);
+                return 1;
+            }
+        }
+    }
+    printf("Hashtable agrees with the multimap table\n");
+    return 0;
+}
+
+
+template <class F> static double Milliseconds(F run)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double, std::milli> taken = std::chrono::steady_clock::now() - start;
+    return taken.count();
+}
+
+static volatile long sink; // so the lookups are not optimized away
+
+/* Times n distinct keys entered, looked up and missed, and n values
+ * entered eight to a key, found and removed newest first, the way the
+ * scopes shadow and unshadow names. The best of three runs of each.
+ */
+template <class Table> static void Time(const char *name, int n,
+                                        const std::vector<std::string> &keys,
+                                        const std::vector<std::string> &misses)
+{
+    double best[4] = { 1e30, 1e30, 1e30, 1e30 };
+    for (int run = 0; run < 3; run++) {
+        Table *table = new Table, *shadows = new Table;
+        double taken[4];
+        taken[0] = Milliseconds([&] {
+            for (int i = 0; i < n; i++)
+                table->Enter(keys[i].c_str(), (long *)(size_t)(i + 1));
+        });
+        taken[1] = Milliseconds([&] {
+            long sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += (long)table->Lookup(keys[i].c_str());
+            sink = sum;
+        });
+        taken[2] = Milliseconds([&] {
+            long sum = 0;
+            for (int i = 0; i < n; i++)
+                sum += (long)table->Lookup(misses[i].c_str());
+            sink = sum;
+        });
+        taken[3] = Milliseconds([&] {
+            long sum = 0;
+            for (int i = 0; i < n; i++)
+                shadows->Enter(keys[i / 8].c_str(), (long *)(size_t)(i + 1), false);
+            for (int i = 0; i < n; i++)
+                sum += (long)shadows->Lookup(keys[i / 8].c_str());
+            for (int i = n - 1; i >= 0; i--)
+                shadows->Remove(keys[i / 8].c_str(), (long *)(size_t)(i + 1));
+            sink = sum;
+        });
+        for (int k = 0; k < 4; k++)
+            best[k] = std::min(best[k], taken[k]);
+        delete table;
+        delete shadows;
+    }
+    printf("%-9s %8d %10.2f %10.2f %10.2f %10.2f\n",
+           name, n, best[0], best[1], best[2], best[3]);
+}
+
+static int Benchmark()
+{
+    printf("%-9s %8s %10s %10s %10s %10s  (ms)\n",
+           "table", "keys", "enter", "hit", "miss", "shadowed");
+    for (int n = 1000; n <= 1000000; n *= 10) {
+        std::vector<std::string> keys, misses;
+        for (int i = 0; i < n; i++) {
+            keys.push_back("ident_" + std::to_string(i * 7919L));
+            misses.push_back("other_" + std::to_string(i));
+        }
+        Time<ReferenceTable<long *> >("multimap", n, keys, misses);
+        Time<Hashtable<long *> >("Hashtable", n, keys, misses);
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return Benchmark();
+    return RandomTest();
+}
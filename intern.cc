@@ -0,0 +1,107 @@
+/* File: intern.cc
+ * ---------------
+ * Implementation of the name pool. The pool is an open-addressing hash
+ * table of pointers to the canonical strings, which are themselves
+ * packed into large character blocks so interning a new name costs no
+ * more than a bump of a pointer. A single mutex guards both.
+ */
+
+#include "intern.h"
+#include "utility.h" // for Failure()
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <mutex>
+#include <vector>
+
+static const size_t BlockSize = 64 * 1024;
+
+/* The built-in Type objects intern their names during static
+ * initialization, so the pool is built on first use rather than being
+ * a global that might not have been constructed yet.
+ */
+struct NamePool {
+    std::mutex lock;
+    std::vector<const char *> slots; // power of two, NULL = empty
+    size_t numNames;
+    char *block;                     // current character block
+    size_t blockLeft;                // bytes still free in it
+
+    NamePool() : slots(1024), numNames(0), block(NULL), blockLeft(0) {}
+};
+
+static NamePool &Pool()
+{
+    static NamePool pool;
+    return pool;
+}
+
+/* FNV-1a, which is plenty for short identifiers. */
+static uint32_t Hash(const char *str, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+    return h;
+}
+
+/* Returns the slot that holds the name, or the empty slot where it
+ * belongs if it is not in the table yet.
+ */
+static size_t Probe(const std::vector<const char *> &table,
+                    const char *str, size_t len)
+{
+    size_t mask = table.size() - 1;
+    size_t i = Hash(str, len) & mask;
+    while (table[i] &&
+           (strncmp(table[i], str, len) != 0 || table[i][len] != '\0'))
+        i = (i + 1) & mask;
+    return i;
+}
+
+static const char *Store(NamePool &pool, const char *str, size_t len)
+{
+    if (len + 1 > pool.blockLeft) {
+        size_t size = len + 1 > BlockSize ? len + 1 : BlockSize;
+        if (!(pool.block = (char *)malloc(size)))
+            Failure("Out of memory interning names");
+        pool.blockLeft = size;
+    }
+    char *copy = pool.block;
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    pool.block += len + 1;
+    pool.blockLeft -= len + 1;
+    return copy;
+}
+
+static void Grow(NamePool &pool)
+{
+    std::vector<const char *> bigger(pool.slots.size() * 2);
+    for (size_t i = 0; i < pool.slots.size(); i++) {
+        const char *name = pool.slots[i];
+        if (name)
+            bigger[Probe(bigger, name, strlen(name))] = name;
+    }
+    pool.slots.swap(bigger);
+}
+
+const char *Intern(const char *str, size_t len)
+{
+    NamePool &pool = Pool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    size_t i = Probe(pool.slots, str, len);
+    if (pool.slots[i])
+        return pool.slots[i];
+
+    const char *name = Store(pool, str, len);
+    pool.slots[i] = name;
+    if (++pool.numNames * 2 > pool.slots.size())
+        Grow(pool);
+    return name;
+}
+
+const char *Intern(const char *str)
+{
+    return Intern(str, strlen(str));
+}
@@ -0,0 +1,38 @@
+/* File: intern.h
+ * --------------
+ * This file declares a pool of interned names. Interning a string hands
+ * back the one canonical copy of its characters, so two interned names
+ * are equal exactly when their pointers are equal. The scanner interns
+ * every identifier it reads, and the names carried by Identifier, Decl
+ * and the type nodes are all interned, so name comparisons during
+ * semantic checking are pointer compares rather than strcmp calls.
+ *
+ * The pool is shared by the whole process and is safe to use from
+ * several threads at once. Interned strings live until the program
+ * exits.
+ */
+
+#ifndef _H_intern
+#define _H_intern
+
+#include <stddef.h>   // for size_t
+
+
+/* Function: Intern()
+ * Usage: const char *name = Intern(yytext, yyleng);
+ * -------------------------------------------------
+ * Returns the canonical copy of the first len characters of str (which
+ * need not be NUL-terminated). The result is NUL-terminated and must
+ * not be modified or freed.
+ */
+const char *Intern(const char *str, size_t len);
+
+
+/* Function: Intern()
+ * Usage: const char *name = Intern("length");
+ * -------------------------------------------
+ * Same as above for a NUL-terminated string.
+ */
+const char *Intern(const char *str);
+
+#endif
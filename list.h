@@ -3,9 +3,9 @@
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
  * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
- * is familiar with the C++ templates, this class provides a more familiar
- * interface.
+ * array that grows as needed, with some added range-checking. Given not
+ * everyone is familiar with the C++ templates, this class provides a more
+ * familiar interface.
  *
  * It can handle elements of any type, the typename for a List includes the
  * element type in angle brackets, e.g.  to store elements of type double,
@@ -23,34 +23,71 @@
  *       }
  *       return sum;
  *    }
+ *
+ * or, more simply, for (int val : *list) sum += val;
+ *
+ * Most lists in a tree hold only a handful of elements, so a list keeps
+ * its first few in the List object itself and only needs more memory
+ * once it grows past them. How many is the optional second argument,
+ * e.g. List<Expr*, 2>; a list with none (the default) puts even its
+ * first element elsewhere. Elements are moved around as bytes, so they
+ * must be simple values such as pointers and numbers.
+ *
+ * A list made while a compilation is running lives in its arena, as the
+ * elements it holds do, and so goes when the tree does (see arena.h).
  */
 
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
 #include <algorithm>
+#include <string.h>   // for memmove()
+#include <type_traits>
 #include "utility.h"  // for Assert()
+#include "arena.h"
   
 class Node;
 
-template<class Element> class List {
+template<class Element, int InlineCapacity> class List { // default 0, see utility.h
 
  private:
-    std::deque<Element> elems;
+    Element *elems;           // inlineElems until the list outgrows it
+    int count, capacity;
+    ArenaAllocator<Element> alloc;
+    Element inlineElems[InlineCapacity > 0 ? InlineCapacity : 1];
+
+    static_assert(std::is_trivially_copyable<Element>::value,
+                  "List elements are copied as bytes");
+
+    void Reserve(int needed)
+	{ if (needed <= capacity) return;
+	  int newCapacity = std::max(needed, 2 * capacity);
+	  Element *moved = alloc.allocate(newCapacity);
+	  memcpy(moved, elems, count * sizeof(Element));
+	  if (elems != inlineElems) alloc.deallocate(elems, capacity);
+	  elems = moved;
+	  capacity = newCapacity; }
 
  public:
+    static void *operator new(size_t size) { return ArenaAllocate(size); }
+    static void operator delete(void *p) {}
+
            // Create a new empty list
-    List() {}
+    List() : elems(inlineElems), count(0), capacity(InlineCapacity) {}
            // Copy a list
-    List(const List<Element> &lst) : elems(lst.elems) {}
+    List(const List<Element, InlineCapacity> &lst)
+      : elems(inlineElems), count(0), capacity(InlineCapacity)
+	{ AppendAll(lst); }
+    List &operator=(const List &) = delete;
+
+    ~List() { if (elems != inlineElems) alloc.deallocate(elems, capacity); }
 
            // Clear the list
-    void Clear() { elems.clear(); }
+    void Clear() { count = 0; }
 
            // Returns count of elements currently in list
     int NumElements() const
-	{ return elems.size(); }
+	{ return count; }
 
           // Returns element at index in list. Indexing is 0-based.
           // Raises an assert if index is out of range.
@@ -58,40 +95,56 @@ template<class Element> class List {
 	{ Assert(index >= 0 && index < NumElements());
 	  return elems[index]; }
 
+          // The elements in order, for range-based for loops
+    Element *begin() { return elems; }
+    Element *end() { return elems + count; }
+    const Element *begin() const { return elems; }
+    const Element *end() const { return elems + count; }
+
           // Inserts element at index, shuffling over others
           // Raises assert if index out of range
     void InsertAt(const Element &elem, int index)
 	{ Assert(index >= 0 && index <= NumElements());
-	  elems.insert(elems.begin() + index, elem); }
+	  Reserve(count + 1);
+	  memmove(elems + index + 1, elems + index, (count - index) * sizeof(Element));
+	  elems[index] = elem;
+	  count++; }
 
           // Adds element to list end
     void Append(const Element &elem)
-	{ elems.push_back(elem); }
+	{ if (count == capacity) {
+	      Element copy = elem; // elem may be in the list
+	      Reserve(count + 1);
+	      elems[count++] = copy;
+	  } else
+	      elems[count++] = elem; }
 
 	  // Adds all elements to list end
-    void AppendAll(const List<Element> &lst)
-        { for (int i = 0; i < lst.NumElements(); i++)
-             Append(lst.Nth(i)); }
+    template <int N> void AppendAll(const List<Element, N> &lst)
+        { Reserve(count + lst.NumElements());
+	  for (const Element &elem : lst)
+	     elems[count++] = elem; }
 
          // Removes element at index, shuffling down others
          // Raises assert if index out of range
     void RemoveAt(int index)
 	{ Assert(index >= 0 && index < NumElements());
-	  elems.erase(elems.begin() + index); }
+	  memmove(elems + index, elems + index + 1, (count - index - 1) * sizeof(Element));
+	  count--; }
 
 	 // Removes all elements of a specific value
     void Remove(const Element &elem)
-        { elems.erase(std::remove(elems.begin(), elems.end(), elem), elems.end()); }
+        { count = std::remove(begin(), end(), elem) - begin(); }
 
 	 // Removes all elements in the given list
-    void RemoveAll(const List<Element> &lst)
-        { for (int i = 0; i < lst.NumElements(); i++)
-	     Remove(lst.Nth(i)); }
+    template <int N> void RemoveAll(const List<Element, N> &lst)
+        { for (const Element &elem : lst)
+	     Remove(elem); }
 
 	 // Sort and remove repeated elements
     void Unique()
-        { std::sort(elems.begin(), elems.end());
-	  elems.erase(std::unique(elems.begin(), elems.end()), elems.end()); }
+        { std::sort(begin(), end());
+	  count = std::unique(begin(), end()) - begin(); }
           
        // These are some specific methods useful for lists of ast nodes
        // They will only work on lists of elements that respond to the
@@ -99,14 +152,13 @@ template<class Element> class List {
        // you can still have Lists of ints, chars*, as long as you 
        // don't try to SetParentAll on that list.
     void SetParentAll(Node *p)
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->SetParent(p); }
+        { for (Element elem : *this)
+             elem->SetParent(p); }
     void PrintAll(int indentLevel, const char *label = NULL)
-        { for (int i = 0; i < NumElements(); i++)
-             Nth(i)->Print(indentLevel, label); }
+        { for (Element elem : *this)
+             elem->Print(indentLevel, label); }
              
 
 };
 
 #endif
-
@@ -2,13 +2,20 @@
  * ----------------
  * This file just contains features relative to the location structure
  * used to record the lexical position of a token or symbol.  This file
- * establishes the common definition for the yyltype structure, the global
- * variable yylloc, and a utility function to join locations you might
- * find handy at times.
+ * establishes the common definition for the yyltype structure and a
+ * utility function to join locations you might find handy at times.
+ * (There is no global yylloc: the parser is pure and keeps its own.)
+ *
+ * The scanner and parser pass yyltypes around, but a node only keeps a
+ * SourceLocation: where its span starts in the program text and how
+ * long it is. Lines and columns are worked out from that when someone
+ * asks for them, which is rare (an error message, or --dump-ast).
  */
 
 #ifndef YYLTYPE
 
+#include <stdint.h>
+
 /* Typedef: yyltype
  * ----------------
  * Defines the struct type that is used by the scanner to store
@@ -16,14 +23,33 @@
  */
 typedef struct yyltype
 {
-    int timestamp;                 // you can ignore this field
     int first_line, first_column;
     int last_line, last_column;      
-    char *text;                    // you can also ignore this field
+    unsigned first_offset, last_offset; // of the first and last characters
 } yyltype;
 
 #define YYLTYPE yyltype
 
+// Bison's default, plus the offsets
+#define YYLLOC_DEFAULT(Current, Rhs, N)                                 \
+    do {                                                                \
+        if (N) {                                                        \
+            (Current).first_line = YYRHSLOC(Rhs, 1).first_line;         \
+            (Current).first_column = YYRHSLOC(Rhs, 1).first_column;     \
+            (Current).first_offset = YYRHSLOC(Rhs, 1).first_offset;     \
+            (Current).last_line = YYRHSLOC(Rhs, N).last_line;           \
+            (Current).last_column = YYRHSLOC(Rhs, N).last_column;       \
+            (Current).last_offset = YYRHSLOC(Rhs, N).last_offset;       \
+        } else {                                                        \
+            (Current).first_line = (Current).last_line =                \
+                YYRHSLOC(Rhs, 0).last_line;                             \
+            (Current).first_column = (Current).last_column =            \
+                YYRHSLOC(Rhs, 0).last_column;                           \
+            (Current).first_offset = (Current).last_offset =            \
+                YYRHSLOC(Rhs, 0).last_offset;                           \
+        }                                                               \
+    } while (0)
+
 inline bool operator< (const yyltype &pos1, const yyltype &pos2) {
     int diff;
     if ((diff = pos1.first_line - pos2.first_line)) return diff < 0;
@@ -33,14 +59,6 @@ inline bool operator< (const yyltype &pos1, const yyltype &pos2) {
     return false;
 }
 
-/* Global variable: yylloc
- * ------------------------
- * The global variable holding the position information about the
- * lexeme just scanned.
- */
-extern struct yyltype yylloc;
-
-
 /* Function: Join
  * --------------
  * Takes two locations and returns a new location which represents
@@ -53,6 +71,8 @@ inline yyltype Join(yyltype first, yyltype last)
   combined.first_line = first.first_line;
   combined.last_column = last.last_column;
   combined.last_line = last.last_line;
+  combined.first_offset = first.first_offset;
+  combined.last_offset = last.last_offset;
   return combined;
 }
 
@@ -63,5 +83,50 @@ inline yyltype Join(yyltype *firstPtr, yyltype *lastPtr)
 }
 
 
+/* Class: SourceLocation
+ * ---------------------
+ * The span of a node in the text of the compilation running on this
+ * thread, as an offset and a length. Decode() gives it back as the
+ * yyltype the scanner made; the line is found by a binary search of the
+ * line table and the column by counting along the line the way the
+ * scanner does (see SourceText::ColumnOf()). A default SourceLocation is
+ * no location at all, and is false.
+ */
+class SourceLocation
+{
+  public:
+    SourceLocation() : offset(None), length(0) {}
+    SourceLocation(const yyltype &loc)
+      : offset(loc.first_offset), length(loc.last_offset + 1 - loc.first_offset) {}
+    SourceLocation(uint32_t off, uint32_t len) : offset(off), length(len) {}
+
+    explicit operator bool() const { return offset != None; }
+    bool operator==(const SourceLocation &other) const
+        { return offset == other.offset && length == other.length; }
+    bool operator!=(const SourceLocation &other) const
+        { return !(*this == other); }
+
+    uint32_t Offset() const { return offset; }
+    uint32_t Length() const { return length; }
+
+    int Line() const;      // first_line
+    yyltype Decode() const;
+
+  private:
+    static const uint32_t None = 0xffffffff;
+    uint32_t offset, length;
+
+    friend SourceLocation Join(SourceLocation first, SourceLocation last);
+};
+
+inline SourceLocation Join(SourceLocation first, SourceLocation last)
+{
+  SourceLocation combined;
+  combined.offset = first.offset;
+  combined.length = last.offset + last.length - first.offset;
+  return combined;
+}
+
+
 #endif
 
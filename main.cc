@@ -6,26 +6,65 @@
  
 #include <string.h>
 #include <stdio.h>
+#include <thread>
+#include <iostream>
 #include "utility.h"
+#include "list.h"
 #include "errors.h"
 #include "parser.h"
-#include "symbols.h"
+#include "compilation.h"
+#include "ast_dump.h"
 
 
 /* Function: main()
  * ----------------
  * Entry point to the entire program.  We parse the command line and turn
  * on any debugging flags requested by the user when invoking the program.
- * InitScanner() is used to set up the scanner.
- * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * InitParser() is used to set up the parser. A Compilation then runs its
+ * phases on the named source file (or stdin if none was given): it is
+ * parsed, checked and, with --dump-ast, printed. Given several files, we
+ * compile them on separate threads, as many at once as --jobs=N allows
+ * (by default, one per core). --phase-stats reports what each phase of
+ * each compilation took. --emit-ast=FILE saves the tree as an AST image
+ * (see ast_image.h); given without a name, each file's goes next to it,
+ * in file.decaf.dast. --load-ast=FILE takes the tree from an image in
+ * place of a source file. --dump-ast=json or =text writes the tree for
+ * other tools (see ast_dump.h).
  */
 int main(int argc, char *argv[])
 {
-        ParseCommandLine(argc, argv);
+        List<const char*> paths;
+        ParseCommandLine(argc, argv, &paths);
 
-        InitScanner();
         InitParser();
-        yyparse();
-        return (ReportError::NumErrors() == 0? 0 : -1);
+        const char *image = GetOption("load-ast");
+        const char *emit = GetOption("emit-ast");
+        if ((image && (!*image || paths.NumElements() > 0)) ||
+            (emit && *emit && paths.NumElements() > 1)) {
+                fprintf(stderr, "Usage: --load-ast=FILE takes no source files, and "
+                        "--emit-ast=FILE one at most (--emit-ast names one image per file)\n");
+                return 2;
+        }
+        const char *dump = GetOption("dump-ast");
+        DumpFormat format;
+        if (dump && *dump && !ParseDumpFormat(dump, &format)) {
+                fprintf(stderr, "Usage: --dump-ast prints the tree; --dump-ast=json "
+                        "or --dump-ast=text writes it for other tools\n");
+                return 2;
+        }
+        if (paths.NumElements() > 1) {
+                const char *jobs = GetOption("jobs");
+                return CompileFiles(&paths, jobs && *jobs ? atoi(jobs)
+                                : std::thread::hardware_concurrency());
+        }
+
+        Compilation comp(image ? image : paths.NumElements() ? paths.Nth(0) : NULL);
+        if (!comp.Run()) {
+                fprintf(stderr, image ? "*** Cannot load AST image '%s'\n"
+                                      : "*** Cannot open source file '%s'\n", comp.GetPath());
+                return 2;
+        }
+        if (GetOption("phase-stats"))
+                comp.PrintStats(std::cerr);
+        return (comp.NumErrors() == 0? 0 : -1);
 }
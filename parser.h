@@ -28,11 +28,13 @@
 // we are compiling y.tab.c, which we use the YYBISON symbol for. 
 // Managing C headers can be such a mess! 
 
+class Compilation;               // yyparse() is given the one to parse for
+
 #ifndef YYBISON                 
 #include "y.tab.h"              
 #endif
 
-int yyparse();              // Defined in the generated y.tab.c file
+int yyparse(Compilation *comp); // Defined in the generated y.tab.c file
 void InitParser();          // Defined in parser.y
 
 #endif
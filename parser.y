@@ -1,6 +1,17 @@
 /* File: parser.y
  * --------------
  * Yacc input file to generate the parser for the compiler.
+ *
+ * This is a pure parser: yylval, yylloc and the parse stacks are local
+ * to each call of yyparse(), which is given the Compilation it parses
+ * for and passes it on to yylex(). Several compilations can therefore
+ * be parsed at once on different threads.
+ *
+ * Lists are left-recursive, so the parse stack only grows with how
+ * deeply constructs nest, not with how long a list is. yyltype and
+ * YYSTYPE are plain data, and saying so lets bison grow its stacks past
+ * YYINITDEPTH (without it, a C++ parser gives up there), up to a
+ * YYMAXDEPTH that allows hundreds of thousands of levels of nesting.
  */
 
 %{
@@ -8,11 +19,21 @@
 #include "scanner.h" // for yylex
 #include "parser.h"
 #include "errors.h"
+#include "compilation.h"
 
-void yyerror(const char *msg); // standard error-handling routine
+void yyerror(yyltype *loc, Compilation *comp, const char *msg); // standard error-handling routine
+
+#define YYLTYPE_IS_TRIVIAL 1
+#define YYSTYPE_IS_TRIVIAL 1
+#define YYMAXDEPTH 1000000
 
 %}
 
+%define api.pure full
+%locations
+%parse-param {Compilation *comp}
+%lex-param {Compilation *comp}
+
  
 /* yylval 
  * ------
@@ -22,19 +43,19 @@ void yyerror(const char *msg); // standard error-handling routine
     bool boolConstant;
     char *stringConstant;
     double doubleConstant;
-    char identifier[MaxIdentLen+1]; // +1 for terminating null
+    const char *identifier;         // interned, see intern.h
     Decl *decl;
     List<Decl*> *declList;
     Type *type;
     NamedType *cType;
-    List<NamedType*> *cTypeList;
+    List<NamedType*, 1> *cTypeList;
     FnDecl *fDecl;
     VarDecl *var;
-    List<VarDecl*> *varList;
+    List<VarDecl*, 2> *varList;
     Expr *expr;
-    List<Expr*> *exprList;
+    List<Expr*, 2> *exprList;
     Stmt *stmt;
-    List<Stmt*> *stmtList;
+    List<Stmt*, 2> *stmtList;
     LValue *lvalue;
     Case *aCase;
     List<Case*> *caseList;
@@ -74,7 +95,7 @@ void yyerror(const char *msg); // standard error-handling routine
 %type <varList>   Formals FormalList VarDecls
 %type <exprList>  Actuals ExprList
 %type <stmt>      Stmt StmtBlock OptElse
-%type <stmtList>  StmtList
+%type <stmtList>  StmtList StmtSeq
 %type <stmt>      SwitchStmt
 %type <aCase>     Case OptDefault
 %type <caseList>  CaseList
@@ -104,10 +125,8 @@ void yyerror(const char *msg); // standard error-handling routine
  */
 Program   :    DeclList            { 
                                       @1; 
-                                      Program *program = new Program($1);
-                                      // if no errors, advance to next phase
-                                      if (ReportError::NumErrors() == 0) 
-                                          program->Check();
+                                      // checking is a later phase, see Compilation
+                                      comp->SetProgram(new Program($1));
                                     }
           ;
 
@@ -156,12 +175,12 @@ OptExt    :    T_Extends T_Identifier
 
 OptImpl   :    T_Implements ImpList 
                                     { $$ = $2; }
-          |    /* empty */          { $$ = new List<NamedType*>; }
+          |    /* empty */          { $$ = new List<NamedType*, 1>; }
           ;
 
 ImpList   :    ImpList ',' T_Identifier    
                                     { ($$=$1)->Append(new NamedType(new Identifier(@3, $3))); }
-          |    T_Identifier         { ($$=new List<NamedType*>)->Append(new NamedType(new Identifier(@1, $1))); }
+          |    T_Identifier         { ($$=new List<NamedType*, 1>)->Append(new NamedType(new Identifier(@1, $1))); }
           ;
 
 FieldList :    FieldList Field      { ($$=$1)->Append($2); }
@@ -180,12 +199,12 @@ FnHeader  :    Type T_Identifier '(' Formals ')'
           ;
 
 Formals   :    FormalList           { $$ = $1; }
-          |    /* empty */          { $$ = new List<VarDecl*>; }
+          |    /* empty */          { $$ = new List<VarDecl*, 2>; }
           ;
 
 FormalList:    FormalList ',' Variable  
                                     { ($$=$1)->Append($3); }
-          |    Variable             { ($$ = new List<VarDecl*>)->Append($1); }
+          |    Variable             { ($$ = new List<VarDecl*, 2>)->Append($1); }
           ;
 
 FnDecl    :    FnHeader StmtBlock   { ($$=$1)->SetFunctionBody($2); }
@@ -196,11 +215,15 @@ StmtBlock :    '{' VarDecls StmtList '}'
           ;
 
 VarDecls  :    VarDecls VarDecl     { ($$=$1)->Append($2); }
-          |    /* empty */          { $$ = new List<VarDecl*>; }
+          |    /* empty */          { $$ = new List<VarDecl*, 2>; }
+          ;
+
+StmtList  :    StmtSeq              { $$ = $1; }
+          |    /* empty */          { $$ = new List<Stmt*, 2>; }
           ;
 
-StmtList  :    Stmt StmtList        { $$ = $2; $$->InsertAt($1, 0); }
-          |    /* empty */          { $$ = new List<Stmt*>; }
+StmtSeq   :    StmtSeq Stmt         { ($$=$1)->Append($2); }
+          |    Stmt                 { ($$ = new List<Stmt*, 2>)->Append($1); }
           ;
 
 Stmt      :    OptExpr ';'          { $$ = $1; }
@@ -239,26 +262,26 @@ OptExpr   :    Expr                 { $$ = $1; }
 Expr      :    LValue               { $$ = $1; }
           |    Call
           |    Constant
-          |    LValue '=' Expr      { $$ = new AssignExpr($1, new Operator(@2,"="), $3); }
-          |    Expr '+' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "+"), $3); }
-          |    Expr '-' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2, "-"), $3); }
-          |    Expr '/' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"/"), $3); }
-          |    Expr '*' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"*"), $3); }
-          |    Expr '%' Expr        { $$ = new ArithmeticExpr($1, new Operator(@2,"%"), $3); }
-          |    Expr T_Equal Expr    { $$ = new EqualityExpr($1, new Operator(@2,"=="), $3); }
-          |    Expr T_NotEqual Expr { $$ = new EqualityExpr($1, new Operator(@2,"!="), $3); }
-          |    Expr '<' Expr        { $$ = new RelationalExpr($1, new Operator(@2,"<"), $3); }
-          |    Expr '>' Expr        { $$ = new RelationalExpr($1, new Operator(@2,">"), $3); }
+          |    LValue '=' Expr      { $$ = new AssignExpr($1, AssignOp, @2, $3); }
+          |    Expr '+' Expr        { $$ = new ArithmeticExpr($1, PlusOp, @2, $3); }
+          |    Expr '-' Expr        { $$ = new ArithmeticExpr($1, MinusOp, @2, $3); }
+          |    Expr '/' Expr        { $$ = new ArithmeticExpr($1, DivideOp, @2, $3); }
+          |    Expr '*' Expr        { $$ = new ArithmeticExpr($1, TimesOp, @2, $3); }
+          |    Expr '%' Expr        { $$ = new ArithmeticExpr($1, ModOp, @2, $3); }
+          |    Expr T_Equal Expr    { $$ = new EqualityExpr($1, EqualOp, @2, $3); }
+          |    Expr T_NotEqual Expr { $$ = new EqualityExpr($1, NotEqualOp, @2, $3); }
+          |    Expr '<' Expr        { $$ = new RelationalExpr($1, LessOp, @2, $3); }
+          |    Expr '>' Expr        { $$ = new RelationalExpr($1, GreaterOp, @2, $3); }
           |    Expr T_LessEqual Expr 
-                                    { $$ = new RelationalExpr($1, new Operator(@2,"<="), $3); }
+                                    { $$ = new RelationalExpr($1, LessEqualOp, @2, $3); }
           |    Expr T_GreaterEqual Expr 
-                                    { $$ = new RelationalExpr($1, new Operator(@2,">="), $3); }
-          |    Expr T_And Expr      { $$ = new LogicalExpr($1, new Operator(@2,"&&"), $3); }
-          |    Expr T_Or Expr       { $$ = new LogicalExpr($1, new Operator(@2,"||"), $3); }
+                                    { $$ = new RelationalExpr($1, GreaterEqualOp, @2, $3); }
+          |    Expr T_And Expr      { $$ = new LogicalExpr($1, AndOp, @2, $3); }
+          |    Expr T_Or Expr       { $$ = new LogicalExpr($1, OrOp, @2, $3); }
           |    '(' Expr ')'         { $$ = $2; }
           |    '-' Expr  %prec T_UnaryMinus 
-                                    { $$ = new ArithmeticExpr(new Operator(@1,"-"), $2); }
-          |    '!' Expr             { $$ = new LogicalExpr(new Operator(@1,"!"), $2); }
+                                    { $$ = new ArithmeticExpr(MinusOp, @1, $2); }
+          |    '!' Expr             { $$ = new LogicalExpr(NotOp, @1, $2); }
           |    T_ReadInteger '(' ')'   
                                     { $$ = new ReadIntegerExpr(Join(@1,@3)); }
           |    T_ReadLine '(' ')'   { $$ = new ReadLineExpr(Join(@1,@3)); }
@@ -267,8 +290,8 @@ Expr      :    LValue               { $$ = $1; }
           |    T_NewArray '(' Expr ',' Type ')' 
                                     { $$ = new NewArrayExpr(Join(@1,@6),$3, $5); }
           |    T_This               { $$ = new This(@1); }
-          |    LValue T_Increm      { $$ = new PostfixExpr($1, new Operator(@2, "++")); }
-          |    LValue T_Decrem      { $$ = new PostfixExpr($1, new Operator(@2, "--")); }
+          |    LValue T_Increm      { $$ = new PostfixExpr($1, IncrementOp, @2); }
+          |    LValue T_Decrem      { $$ = new PostfixExpr($1, DecrementOp, @2); }
           ;
 
 Constant  :    T_IntConstant        { $$ = new IntConstant(@1,$1); }
@@ -279,11 +302,11 @@ Constant  :    T_IntConstant        { $$ = new IntConstant(@1,$1); }
           ;
 
 Actuals   :    ExprList             { $$ = $1; }
-          |    /* empty */          { $$ = new List<Expr*>; }
+          |    /* empty */          { $$ = new List<Expr*, 2>; }
           ;
 
 ExprList  :    ExprList ',' Expr    { ($$=$1)->Append($3); }
-          |    Expr                 { ($$ = new List<Expr*>)->Append($1); }
+          |    Expr                 { ($$ = new List<Expr*, 2>)->Append($1); }
           ;
 
 OptElse   :    T_Else Stmt          { $$ = $2; }
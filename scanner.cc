@@ -0,0 +1,155 @@
+/* File: scanner.cc
+ * ----------------
+ * The part of the scanner shared by both back ends: picking which
+ * scanner to run and quoting source lines for error messages. The flex
+ * scanner is the default when it has been built in; --scanner=hand
+ * selects the hand-written one. Building with SCANNER=hand (see the
+ * Makefile) leaves flex out entirely. With --token-cache=<file>, Lex()
+ * may replay saved tokens instead of running either one.
+ */
+
+#include "scanner.h"
+#include "utility.h" // for PrintDebug(), GetOption()
+#include "parser.h"  // for token codes, YYSTYPE
+#include "source.h"
+#include "compilation.h"
+#include <string.h>
+
+Scanner::Scanner()
+  : source(NULL), useHandScanner(false), traceTokens(false),
+    replaying(false), recording(false), flex(NULL)
+{
+}
+
+Scanner::~Scanner()
+{
+#ifndef NO_FLEX_SCANNER
+    if (flex)
+        FlexDestroy(flex);
+#endif
+}
+
+/* Function: Scanner::Init
+ * -----------------------
+ * This function will be called before any calls to Lex(). The chosen
+ * scanner lexes the text in place, except that flex has to copy text
+ * that is read-only (see --bounded-memory in source.h) into its own
+ * buffer a chunk at a time.
+ */
+void Scanner::Init(SourceText *s)
+{
+    PrintDebug("lex", "Initializing scanner");
+    source = s;
+
+    const char *which = GetOption("scanner");
+#ifdef NO_FLEX_SCANNER
+    if (which && strcmp(which, "hand") != 0) {
+        fprintf(stderr, "*** This dcc was built with only the hand-written scanner\n");
+        exit(2);
+    }
+    useHandScanner = true;
+#else
+    if (which && strcmp(which, "hand") != 0 && strcmp(which, "flex") != 0) {
+        fprintf(stderr, "*** Unknown scanner '%s' (use flex or hand)\n", which);
+        exit(2);
+    }
+    useHandScanner = (which && strcmp(which, "hand") == 0);
+#endif
+    traceTokens = IsDebugOn("tokens");
+
+    const char *cachePath = GetOption("token-cache");
+    if (cachePath && *cachePath) {
+        replaying = cache.Load(cachePath, source);
+        recording = !replaying;
+        if (recording)
+            cache.StartRecording(cachePath, source);
+    }
+
+    if (replaying)
+        return; // neither back end is needed
+    if (useHandScanner)
+        hand.Start(source);
+#ifndef NO_FLEX_SCANNER
+    else {
+        flexState.source = source;
+        flex = FlexCreate(&flexState);
+        if (source->IsReadOnly())
+            FlexScanChunks(flex);
+        else
+            FlexScanText(flex, source->WritableText(), source->Length());
+    }
+#endif
+}
+
+/* Prints one token with its location and value. Used with -d tokens to
+ * compare the token streams of the two scanners.
+ */
+void Scanner::TraceToken(int token, const YYSTYPE *lval, const yyltype *lloc)
+{
+    char value[64] = "";
+    switch (token) {
+      case T_Identifier:     snprintf(value, sizeof(value), " %s", lval->identifier); break;
+      case T_IntConstant:    snprintf(value, sizeof(value), " %d", lval->integerConstant); break;
+      case T_DoubleConstant: snprintf(value, sizeof(value), " %.17g", lval->doubleConstant); break;
+      case T_BoolConstant:   snprintf(value, sizeof(value), " %d", lval->boolConstant); break;
+      case T_StringConstant: snprintf(value, sizeof(value), " %.50s", lval->stringConstant); break;
+    }
+    PrintDebug("tokens", "%d.%d-%d %d%s", lloc->first_line,
+               lloc->first_column, lloc->last_column, token, value);
+}
+
+int Scanner::Lex(YYSTYPE *lval, yyltype *lloc)
+{
+    int token;
+    if (replaying)
+        token = cache.Replay(lval, lloc);
+    else {
+#ifdef NO_FLEX_SCANNER
+        token = hand.Scan(lval, lloc);
+#else
+        token = useHandScanner ? hand.Scan(lval, lloc) : FlexScan(lval, lloc, flex);
+#endif
+        if (recording)
+            cache.Record(token, lval, lloc);
+    }
+    if (traceTokens)
+        TraceToken(token, lval, lloc);
+    return token;
+}
+
+/* Function: Scanner::GetLineNumbered()
+ * ------------------------------------
+ * The line is cut out of the program text on demand; see
+ * SourceText::GetLine().
+ */
+const char *Scanner::GetLineNumbered(int num)
+{
+    char held = '\0';
+    const char *heldAt = NULL;
+#ifndef NO_FLEX_SCANNER
+    if (flex)
+        heldAt = FlexHeldChar(flex, &held);
+#endif
+    return source ? source->GetLine(num, heldAt, held) : NULL;
+}
+
+int yylex(YYSTYPE *lval, yyltype *lloc, Compilation *comp)
+{
+    return comp->scanner.Lex(lval, lloc);
+}
+
+/* Function: GetLineNumbered()
+ * ---------------------------
+ * Returns string with contents of line numbered n or NULL if the
+ * contents of that line are not available. Used by ReportError, which
+ * reports on the compilation running on this thread.
+ */
+const char *GetLineNumbered(int num)
+{
+    Compilation *comp = Compilation::Current();
+    if (!comp)
+        return NULL;
+    const char *line = comp->scanner.GetLineNumbered(num);
+    // a tree loaded from an AST image was never scanned
+    return line ? line : comp->source.GetLine(num, NULL, '\0');
+}
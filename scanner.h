@@ -3,23 +3,93 @@
  * You should not need to modify this file. It declare a few constants,
  * types, variables,and functions that are used and/or exported by
  * the lex-generated scanner.
+ *
+ * There are two scanners: the flex scanner in scanner.l, which is the
+ * reference, and the hand-written one in hand_scanner.cc. They produce
+ * identical tokens, yylval values and yylloc positions. yylex() hands
+ * out tokens from whichever one the compilation's Scanner picked.
+ *
+ * The parser is a pure parser, so yylval and yylloc are not globals:
+ * yylex() is given pointers to the parser's own, along with the
+ * Compilation (see compilation.h) whose scanner it should run.
  */
 
 #ifndef _H_scanner
 #define _H_scanner
 
 #include <stdio.h>
+#include <stddef.h>
+#include "location.h"
+#include "hand_scanner.h"
+#include "token_cache.h"
 
 #define MaxIdentLen 31    // Maximum length for identifiers
 
-extern char *yytext;      // Text of lexeme just scanned
+union YYSTYPE;
+class Compilation;
+class SourceText;
 
 
-int yylex();              // Defined in the generated lex.yy.c file
-void yyrestart(FILE *fp); // ditto
+int yylex(YYSTYPE *lval, yyltype *lloc, Compilation *comp); // Defined in scanner.cc
 
+const char *GetLineNumbered(int n); // ditto, for this thread's compilation
+
+
+/* Struct: FlexState
+ * -----------------
+ * Our part of the flex scanner's state, reached from the rules through
+ * yyextra. Flex keeps the rest in the yyscan_t it hands back.
+ */
+struct FlexState {
+    int curLineNum, curColNum;
+    size_t curOffset;      // offset into the text just past the last match
+    SourceText *source;
+};
+
+// The flex back end, defined in scanner.l. The void * is flex's yyscan_t.
+// FlexScanText() scans a writable text (followed by two NULs) in place;
+// FlexScanChunks() is the alternative for read-only text.
+void *FlexCreate(FlexState *state);
+void FlexDestroy(void *scanner);
+int FlexScan(YYSTYPE *lval, yyltype *lloc, void *scanner);
+void FlexScanText(void *scanner, char *text, size_t length);
+void FlexScanChunks(void *scanner);
+const char *FlexHeldChar(void *scanner, char *held);
+
+
+/* Class: Scanner
+ * --------------
+ * The scanner state belonging to one compilation: which back end it
+ * runs and that back end's own state, or the token cache it is
+ * replaying instead.
+ */
+class Scanner
+{
+  public:
+    Scanner();
+    ~Scanner();
+
+    // Called before any calls to Lex(), once source has been loaded.
+    void Init(SourceText *source);
+
+    // Returns the next token; this is what yylex() calls.
+    int Lex(YYSTYPE *lval, yyltype *lloc);
+
+    // Returns string with contents of line numbered n or NULL if the
+    // contents of that line are not available.
+    const char *GetLineNumbered(int n);
+
+  private:
+    void TraceToken(int token, const YYSTYPE *lval, const yyltype *lloc);
+
+    SourceText *source;
+    bool useHandScanner;
+    bool traceTokens;
+    bool replaying, recording; // see token_cache.h
+    HandScanner hand;
+    TokenCache cache;
+    void *flex;                // NULL unless the flex scanner is running
+    FlexState flexState;
+};
 
-void InitScanner();                 // Defined in scanner.l user subroutines
-const char *GetLineNumbered(int n); // ditto
- 
 #endif
@@ -0,0 +1,47 @@
+/* File: scope.cc
+ * --------------
+ * Implementation of the Scope class.
+ */
+
+#include "scope.h"
+#include "ast_decl.h"
+#include <string.h>
+
+Scope::Scope(const Node *o, const Scope *out, int n)
+  : owner(o), outer(out), slots(NULL), mask(0), numDecls(0)
+{
+    if (n == 0)
+        return;
+    uint32_t size = 4;
+    while (size < 2 * (uint32_t)n)
+        size *= 2;
+    slots = (Entry *)ArenaAllocate(size * sizeof(Entry));
+    memset(slots, 0, size * sizeof(Entry));
+    mask = size - 1;
+}
+
+void Scope::Declare(const Decl *decl)
+{
+    const char *name = decl->getName();
+    Assert(2 * (uint32_t)numDecls < mask + 1);
+    uint32_t i = Slot(name);
+    for (; slots[i].name != NULL; i = (i + 1) & mask)
+        if (slots[i].name == name)
+            return;
+    slots[i].name = name;
+    slots[i].decl = decl;
+    numDecls++;
+}
+
+void Scope::DeclareAll(const Scope *other)
+{
+    if (numDecls == 0 && other->mask == mask && other->numDecls != 0) {
+        // every name goes where it is in other, so copy the lot
+        memcpy(slots, other->slots, (mask + 1) * sizeof(Entry));
+        numDecls = other->numDecls;
+        return;
+    }
+    for (uint32_t i = 0; other->numDecls != 0 && i <= other->mask; i++)
+        if (other->slots[i].name != NULL)
+            Declare(other->slots[i].decl);
+}
@@ -0,0 +1,71 @@
+/* File: scope.h
+ * -------------
+ * This file declares Scope, the table of the names declared directly in
+ * one program, class, interface, function or statement block. Each
+ * holds its declarations in an open-addressing hash table keyed by
+ * their interned names (see intern.h), so looking a name up in it is a
+ * probe or two whatever the number of declarations, and knows the
+ * scope around it, so a search for a name goes from one scope to the
+ * next without visiting the statements and expressions in between.
+ *
+ * The scopes are made by BuildScopes (see ast_passes.h) before the tree
+ * is checked, and live in the compilation's arena with the tree.
+ */
+
+#ifndef _H_scope
+#define _H_scope
+
+#include <stdint.h>
+#include "arena.h"
+
+class Node;
+class Decl;
+
+class Scope
+{
+  public:
+    // An empty scope for the declarations of owner, with room for
+    // numDecls of them, inside outer (NULL if there is nothing a search
+    // can go on to from here).
+    Scope(const Node *owner, const Scope *outer, int numDecls);
+    static void *operator new(size_t size) { return ArenaAllocate(size); }
+    static void operator delete(void *p) {}
+
+    // Adds decl under its name. A name declared twice keeps the first
+    // declaration, which is the one a search from the top finds.
+    void Declare(const Decl *decl);
+
+    // Declares each of the declarations of other here, in no particular
+    // order, as Declare() would.
+    void DeclareAll(const Scope *other);
+
+    // The declaration of name here (not in an outer scope), or NULL.
+    // The name must be interned.
+    const Decl *Lookup(const char *name) const
+    {
+        if (numDecls == 0)
+            return NULL;
+        for (uint32_t i = Slot(name); slots[i].name != NULL; i = (i + 1) & mask)
+            if (slots[i].name == name)
+                return slots[i].decl;
+        return NULL;
+    }
+
+    const Node *GetOwner() const { return owner; }
+    const Scope *GetOuter() const { return outer; }
+    int NumDecls() const { return numDecls; }
+
+  private:
+    uint32_t Slot(const char *name) const
+        { return (uint32_t)(((uintptr_t)name * 0x9E3779B97F4A7C15ull) >> 40) & mask; }
+
+    struct Entry { const char *name; const Decl *decl; };
+
+    const Node *owner;
+    const Scope *outer;
+    Entry *slots;          // a power of two of them, at most half full
+    uint32_t mask;
+    int numDecls;
+};
+
+#endif
@@ -0,0 +1,274 @@
+/* File: source.cc
+ * ---------------
+ * Implementation of the source mapping routines and SourceText.
+ */
+
+#include "source.h"
+#include "utility.h" // for Failure()
+#include "compilation.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+static const size_t PaddingBytes = 2; // flex's double end-of-buffer NUL
+
+static const size_t ReleaseInterval = 4 * 1024 * 1024;
+
+/* Returns the size of the whole mapping (file plus padding) rounded
+ * up to a page boundary.
+ */
+static size_t MappedSize(size_t length)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (length + PaddingBytes + page - 1) / page * page;
+}
+
+/* Maps fd, which must be a regular file, with the given protection.
+ * We first reserve an anonymous zero-filled region big enough for the
+ * file plus the padding, then map the file over the front of it. The
+ * kernel zero-fills the tail of the file's last page, and the anonymous
+ * pages after it are zero as well, so the two NULs flex needs are in
+ * place even when the file ends exactly on a page boundary.
+ */
+static char *MapSourceFd(int fd, size_t *length, int prot)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return NULL;
+
+    size_t len = st.st_size;
+    void *base = mmap(NULL, MappedSize(len), prot,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    if (len > 0 &&
+        mmap(base, len, prot, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, MappedSize(len));
+        return NULL;
+    }
+
+    *length = len;
+    return (char *)base;
+}
+
+char *MapSourceFile(const char *path, size_t *length)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    char *text = MapSourceFd(fd, length, PROT_READ | PROT_WRITE);
+    close(fd); // the mapping keeps its own reference to the file
+    return text;
+}
+
+const char *MapSourceReadOnly(int fd, size_t *length)
+{
+    return MapSourceFd(fd, length, PROT_READ);
+}
+
+char *ReadSourceStream(FILE *fp, size_t *length)
+{
+    size_t capacity = 64 * 1024, len = 0;
+    char *text = (char *)malloc(capacity);
+
+    while (text) {
+        len += fread(text + len, 1, capacity - len - PaddingBytes, fp);
+        if (len < capacity - PaddingBytes)
+            break; // short read means end of file (or error)
+        capacity *= 2;
+        text = (char *)realloc(text, capacity);
+    }
+    if (!text)
+        Failure("Out of memory reading source");
+
+    memset(text + len, 0, PaddingBytes);
+    *length = len;
+    return text;
+}
+
+void UnmapSourceFile(char *text, size_t length)
+{
+    if (text)
+        munmap(text, MappedSize(length));
+}
+
+SourceText::SourceText()
+  : text(NULL), length(0), storage(None), readOnly(false),
+    linesDeferred(false), copied(0), released(0)
+{
+    lineStarts.push_back(0); // line 1 starts at offset 0
+}
+
+SourceText::~SourceText()
+{
+    if (storage == Mapped)
+        UnmapSourceFile((char *)text, length);
+    else if (storage == Heap)
+        free((char *)text);
+}
+
+/* Function: SourceText::Load
+ * --------------------------
+ * A named file is mapped. With boundedMemory the file (or stdin, if it
+ * is redirected from a file) is mapped read-only instead, so its pages
+ * can be released once they have been scanned. Only a pipe still has
+ * to be read into memory.
+ */
+bool SourceText::Load(const char *path, bool boundedMemory)
+{
+    if (boundedMemory) {
+        int fd = path ? open(path, O_RDONLY) : 0;
+        if (fd >= 0)
+            text = MapSourceReadOnly(fd, &length);
+        if (path && fd >= 0)
+            close(fd); // the mapping keeps its own reference to the file
+        if (text) {
+            storage = Mapped;
+            readOnly = true;
+            return true;
+        }
+    }
+    if (path) {
+        text = MapSourceFile(path, &length);
+        storage = Mapped;
+    } else {
+        text = ReadSourceStream(stdin, &length);
+        storage = Heap;
+    }
+    return text != NULL;
+}
+
+/* Function: SourceText::ReleaseBefore
+ * -----------------------------------
+ * Pages of a private mapping that have never been written are just a
+ * view of the file, so MADV_DONTNEED simply drops them; touching them
+ * again (say to quote a line in an error message) reads them back in.
+ * We only bother once a few megabytes have built up.
+ */
+void SourceText::ReleaseBefore(size_t offset)
+{
+    if (!readOnly || offset < released + ReleaseInterval)
+        return;
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t upto = offset / page * page;
+    madvise((char *)text + released, upto - released, MADV_DONTNEED);
+    released = upto;
+}
+
+size_t SourceText::CopyChunk(char *buf, size_t max)
+{
+    size_t n = length - copied;
+    if (n > max) n = max;
+    memcpy(buf, text + copied, n);
+    copied += n;
+    ReleaseBefore(copied);
+    return n;
+}
+
+/* Builds the whole line table in one pass over the text, for when no
+ * scanner has done it.
+ */
+void SourceText::FindLineStarts()
+{
+    const char *p = text, *limit = text + length;
+    while ((p = (const char *)memchr(p, '\n', limit - p)) != NULL) {
+        p++;
+        AddLineStart(p - text);
+        ReleaseBefore(p - text);
+    }
+    linesDeferred = false;
+}
+
+const char *SourceText::GetLine(int num, const char *heldAt, char heldChar)
+{
+    if (linesDeferred) FindLineStarts();
+    if (num <= 0 || num > lineStarts.size()) return NULL;
+    const char *begin = text + lineStarts[num-1];
+    const char *limit = text + length;
+    if (begin >= limit) return NULL; // nothing after the final newline
+    const char *end = (const char *)memchr(begin, '\n', limit - begin);
+    if (!end) end = limit;
+    bool held = (heldAt >= begin && heldAt < end);
+    if (held && heldChar == '\n') end = heldAt;
+    line.assign(begin, end);
+    if (held && heldAt < end) line[heldAt - begin] = heldChar;
+    return line.c_str();
+}
+
+int SourceText::LineOf(size_t offset)
+{
+    if (linesDeferred) FindLineStarts();
+    return std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+}
+
+const std::vector<unsigned int> &SourceText::LineStarts()
+{
+    if (linesDeferred) FindLineStarts();
+    return lineStarts;
+}
+
+void SourceText::Restore(const char *t, size_t len,
+                         const unsigned int *lines, size_t numLines,
+                         const unsigned int *tabs, size_t numTabs)
+{
+    text = t;
+    length = len;
+    storage = None;
+    readOnly = true;
+    lineStarts.assign(lines, lines + numLines);
+    literalTabs.assign(tabs, tabs + numTabs);
+    linesDeferred = false;
+}
+
+/* Counts along the line from its start. A tab the scanner matched on its
+ * own moves to the next tab stop; one inside a string constant, which it
+ * matched as part of the token, counts as one.
+ */
+int SourceText::ColumnOf(size_t offset)
+{
+    size_t start = lineStarts[LineOf(offset) - 1];
+    std::vector<unsigned int>::iterator literal =
+        std::lower_bound(literalTabs.begin(), literalTabs.end(), start);
+    int column = 1;
+    for (size_t i = start; i < offset && i < length; i++) {
+        column++;
+        if (text[i] != '\t')
+            continue;
+        while (literal != literalTabs.end() && *literal < i)
+            ++literal;
+        if (literal == literalTabs.end() || *literal != i)
+            column += (TAB_SIZE - (column - 1) % TAB_SIZE) % TAB_SIZE;
+    }
+    return column;
+}
+
+
+/* SourceLocation
+ * --------------
+ * Decoded against the text of the compilation running on this thread.
+ */
+int SourceLocation::Line() const
+{
+    return Compilation::Current()->source.LineOf(offset);
+}
+
+yyltype SourceLocation::Decode() const
+{
+    SourceText &source = Compilation::Current()->source;
+    size_t last = offset + length - 1;
+    yyltype loc;
+    loc.first_line = source.LineOf(offset);
+    loc.first_column = source.ColumnOf(offset);
+    loc.last_line = length ? source.LineOf(last) : loc.first_line;
+    loc.last_column = length ? source.ColumnOf(last) : loc.first_column - 1;
+    loc.first_offset = offset;
+    loc.last_offset = last;
+    return loc;
+}
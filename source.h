@@ -0,0 +1,158 @@
+/* File: source.h
+ * --------------
+ * This file declares the routines that bring the program text into
+ * memory for the scanner, and the SourceText that holds it. When dcc is given a path on the command line,
+ * the file is mapped with mmap rather than read through stdio, so the
+ * scanner can lex straight out of the mapping without copying it or
+ * refilling a buffer. Input from stdin is read into one heap buffer
+ * laid out the same way. Either way only the offset of each line is
+ * kept; error messages quote lines by cutting them out of the text.
+ *
+ * With --bounded-memory the file is instead mapped read-only and the
+ * scanners hand pages back to the kernel as they finish with them, so
+ * the text of even a very large program never stays resident: a line
+ * quoted later is simply paged back in from the file.
+ */
+
+#ifndef _H_source
+#define _H_source
+
+#include <stddef.h>   // for size_t
+#include <stdio.h>    // for FILE
+#include <string>
+#include <vector>
+
+#define TAB_SIZE 8 // a tab takes the scanners to the next multiple of this, plus 1
+
+
+/* Function: MapSourceFile()
+ * Usage: char *text = MapSourceFile("prog.decaf", &len);
+ * ------------------------------------------------------
+ * Maps the named file into memory and returns a pointer to its first
+ * byte, storing the file length (not counting the padding) in *length.
+ * The mapping is private and writable (flex pokes NULs into its buffer
+ * while it scans) and is followed by two NUL bytes, which is the
+ * end-of-buffer marker yy_scan_buffer() requires. Returns NULL if the
+ * file cannot be opened or mapped.
+ */
+char *MapSourceFile(const char *path, size_t *length);
+
+
+/* Function: MapSourceReadOnly()
+ * Usage: const char *text = MapSourceReadOnly(fd, &len);
+ * ------------------------------------------------------
+ * Like MapSourceFile(), but maps an already open file read-only, so
+ * none of its pages ever become private copies and any of them can be
+ * dropped with SourceText::ReleaseBefore(). Returns NULL if fd is not a
+ * regular file (a pipe, say) or cannot be mapped.
+ */
+const char *MapSourceReadOnly(int fd, size_t *length);
+
+
+/* Function: ReadSourceStream()
+ * Usage: char *text = ReadSourceStream(stdin, &len);
+ * --------------------------------------------------
+ * Reads fp to end of file into a heap buffer padded the same way as
+ * MapSourceFile(), storing the length read in *length.
+ */
+char *ReadSourceStream(FILE *fp, size_t *length);
+
+
+/* Function: UnmapSourceFile()
+ * Usage: UnmapSourceFile(text, len);
+ * ----------------------------------
+ * Releases a mapping obtained from MapSourceFile().
+ */
+void UnmapSourceFile(char *text, size_t length);
+
+
+/* Class: SourceText
+ * -----------------
+ * The text of one compilation and where each of its lines starts. Rather
+ * than the scanner keeping a copy of every line, we just remember the
+ * offsets and cut a line out of the text if an error needs it. Each
+ * Compilation has its own SourceText (see compilation.h), which owns the
+ * text and releases it when destroyed.
+ */
+class SourceText
+{
+  public:
+    SourceText();
+    ~SourceText();
+
+    // Brings in the text: the named file, or stdin if path is NULL.
+    // boundedMemory asks for a read-only mapping whose pages can be
+    // released as they are scanned (see above). Returns false if the
+    // file cannot be opened.
+    bool Load(const char *path, bool boundedMemory);
+
+    // The text is followed by two NULs. It is writable (for flex to scan
+    // in place) unless IsReadOnly(), in which case WritableText() is NULL.
+    const char *Text() const   { return text; }
+    char *WritableText() const { return readOnly ? NULL : (char *)text; }
+    size_t Length() const      { return length; }
+    bool IsReadOnly() const    { return readOnly; }
+
+    // Tells the kernel the text before offset is not needed in memory
+    // any more. Cheap to call often: it does nothing unless the text is
+    // a read-only mapping and a few megabytes have been passed since the
+    // last release. Released pages are read back from the file if
+    // touched again.
+    void ReleaseBefore(size_t offset);
+
+    // Copies the next (up to) max bytes of the text into buf and returns
+    // how many were copied, 0 at the end. This is flex's YY_INPUT when
+    // it cannot scan the text in place because it is read-only.
+    size_t CopyChunk(char *buf, size_t max);
+
+    // Called by the scanner each time it passes a newline, with the
+    // offset into the text where the next line starts.
+    void AddLineStart(size_t offset) { lineStarts.push_back(offset); }
+
+    // Called by the scanner for a tab inside a token (a string constant),
+    // which it counts as one column rather than moving to a tab stop.
+    void AddLiteralTab(size_t offset) { literalTabs.push_back(offset); }
+
+    // Says no scanner will be calling AddLineStart() (the tokens are
+    // coming from the token cache instead), so the line table should be
+    // built from the text itself the first time a line is asked for.
+    void DeferLineStarts() { linesDeferred = true; }
+
+    // Returns a copy of line n (without its newline), or NULL if the
+    // scanner has not reached that line. If heldAt is non-NULL, the byte
+    // at that address has been temporarily replaced by the scanner (flex
+    // does this at the end of the current token) and heldChar is what
+    // belongs there. The result is only valid until the next call.
+    const char *GetLine(int num, const char *heldAt, char heldChar);
+
+    // The line and column of the character at offset, as the scanner
+    // counted them when it passed it. The scanner must have passed it.
+    int LineOf(size_t offset);
+    int ColumnOf(size_t offset);
+
+    // Where the lines and the literal tabs are, for an AST image (see
+    // ast_image.h) to save along with the text.
+    const std::vector<unsigned int> &LineStarts();
+    const std::vector<unsigned int> &LiteralTabs() const { return literalTabs; }
+
+    // Takes the text and those tables from an AST image rather than
+    // from a file. The text is used where it is, and is not freed.
+    void Restore(const char *text, size_t length,
+                 const unsigned int *lines, size_t numLines,
+                 const unsigned int *tabs, size_t numTabs);
+
+  private:
+    void FindLineStarts();
+
+    const char *text;
+    size_t length;
+    enum { None, Mapped, Heap } storage;
+    bool readOnly;
+    std::vector<unsigned int> lineStarts; // lineStarts[n-1] is line n
+    std::vector<unsigned int> literalTabs;
+    bool linesDeferred;
+    size_t copied, released;              // for CopyChunk(), ReleaseBefore()
+    std::string line;                     // returned by GetLine()
+};
+
+#endif
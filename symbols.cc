@@ -1,11 +1,13 @@
 #include "symbols.h"
+#include "compilation.h"
 #include <string>
 
 using std::string;
 
-Hashtable<ClassDecl*> declared_classes;
-Hashtable<FnDecl*> declared_functions;
-Hashtable <InterfaceDecl*> declared_interfaces;
+SymbolTables &CurrentSymbols()
+{
+        return Compilation::Current()->symbols;
+}
 
 
 bool type_exists(const char *name)
@@ -24,7 +26,7 @@ bool type_exists(const char *name)
                 actual = string(name);
         }
 
-        if (declared_classes.Lookup(name) != nullptr)
+        if (CurrentSymbols().declared_classes.Lookup(name) != nullptr)
         {
                 return true;
         }
@@ -45,11 +47,11 @@ bool type_exists(const char *name)
 
 bool add_type(const char *name, ClassDecl *decl)
 {
-        if (declared_classes.Lookup(name) != nullptr)
+        if (CurrentSymbols().declared_classes.Lookup(name) != nullptr)
         {
                 return false;
         }
 
-        declared_classes.Enter(name, decl);
+        CurrentSymbols().declared_classes.Enter(name, decl);
         return true;
 }
@@ -4,9 +4,17 @@
 #include "hashtable.h"
 #include "ast_decl.h"
 
-extern Hashtable<ClassDecl*> declared_classes;
-extern Hashtable<FnDecl*> declared_functions;
-extern Hashtable <InterfaceDecl*> declared_interfaces;
+/* The tables of declared classes, functions and interfaces. Each
+ * compilation has its own (see compilation.h); CurrentSymbols() returns
+ * the ones for the compilation running on this thread.
+ */
+struct SymbolTables {
+        Hashtable<ClassDecl*> declared_classes;
+        Hashtable<FnDecl*> declared_functions;
+        Hashtable <InterfaceDecl*> declared_interfaces;
+};
+
+SymbolTables &CurrentSymbols();
 
 bool type_exists(const char *name);
 
@@ -3,6 +3,575 @@
 
 make
 
+# Writes a program of ${2} statements, generated from the seed ${1}, made
+# to give the scanners a hard time: identifiers of every length up to
+# ${3} (by default 40, past the limit of 31), many of them keywords run
+# into other letters, numbers of every form, comments and strings whose
+# lengths cross the 16 and 32 byte boundaries, and tabs, newlines and
+# comments between tokens.
+generate_program()
+{
+        awk -v seed=${1} -v statements=${2} -v longest=${3:-40} '
+        function pick(n) { return int(rand() * n) }
+        function text(n,    t, i) {
+                t = ""
+                for (i = 0; i < n; i++)
+                        t = t substr(chars, 1 + pick(length(chars)), 1)
+                return t
+        }
+        function comment(n,    t) {
+                t = text(n)
+                gsub(/\*\//, "* /", t)
+                return t
+        }
+        function gap(    r) {
+                r = pick(12)
+                if (r < 5) return " "
+                if (r == 5) return "\t"
+                if (r == 6) return "\n" substr("\t\t  \t", 1 + pick(5))
+                if (r == 7) return " \t"
+                if (r == 8) return "/*" comment(pick(70)) "*/"
+                if (r == 9) return "/*" comment(pick(40)) "\n" comment(pick(40)) "**/"
+                if (r == 10) return "//" text(pick(70)) "\n"
+                return ""
+        }
+        function space(    g) {
+                g = gap()
+                return g == "" ? " " : g
+        }
+        function name(    r, n, s) {
+                r = pick(4)
+                if (r == 0) return keywords[1 + pick(nkeywords)] substr(letters, 1 + pick(52), 1 + pick(3))
+                if (r == 1) return substr(letters, 1 + pick(52), 1) substr(longname, 1, pick(longest))
+                n = pick(8)
+                s = substr(letters, 1 + pick(52), 1) substr(longname, 1 + pick(20), n)
+                return s in keyword ? s "_" : s
+        }
+        function number(    r) {
+                r = pick(5)
+                if (r == 0) return pick(100000)
+                if (r == 1) return "0x" substr("0123456789abcdefABCDEF", 1 + pick(15), 1 + pick(6))
+                if (r == 2) return pick(1000) "." pick(1000)
+                if (r == 3) return pick(100) ".E" (pick(2) ? "+" : "-") pick(30)
+                return pick(10) "." 
+        }
+        function operand(    r) {
+                r = pick(6)
+                if (r < 2) return name()
+                if (r < 4) return number()
+                if (r == 4) return (pick(2) ? "true" : "false")
+                return "null"
+        }
+        function expr(    r) {
+                r = pick(5)
+                if (r == 0) return operand()
+                if (r == 1) return operand() gap() ops[1 + pick(nops)] " " gap() operand()
+                if (r == 2) return "(" gap() operand() gap() "+" gap() operand() gap() ")"
+                if (r == 3) return "!" gap() operand() gap() "&&" gap() operand() gap() "||" gap() operand()
+                return name() gap() "." gap() name() gap() "(" gap() operand() gap() "," gap() operand() gap() ")"
+        }
+        function string(    n) {
+                n = pick(8) < 6 ? pick(70) : 14 + pick(5) + 16 * pick(3)
+                return "\"" text(n) "\""
+        }
+        BEGIN {
+                srand(seed)
+                chars = "abcdefghijklmnopqrstuvwxyz ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789 \t+-*%<>=!&|;,.[](){}/_#@$"
+                letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                longname = "abcdefghijklmnopqrstuvwxyz_0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                nkeywords = split("void int double bool string class interface null this extends implements for while if else return break New NewArray Print ReadInteger ReadLine true false switch case default", keywords, " ")
+                for (i = 1; i <= nkeywords; i++)
+                        keyword[keywords[i]] = 1
+                nops = split("+ - * / % < <= > >= == != && ||", ops, " ")
+                printf "void main() {%s", gap()
+                for (i = 0; i < statements; i++) {
+                        r = pick(7)
+                        if (r == 0) printf "%s%s=%s%s;", name(), gap(), gap(), expr()
+                        else if (r == 1) printf "Print(%s%s,%s%s);", gap(), string(), gap(), expr()
+                        else if (r == 2) printf "if%s(%s)%s{%s%s;%s}%selse%s%s;", gap(), expr(), gap(), gap(), expr(), gap(), gap(), space(), expr()
+                        else if (r == 3) printf "while%s(%s%s)%sbreak;", gap(), expr(), gap(), gap()
+                        else if (r == 4) printf "for(%s;%s;%s)%s%s;", expr(), expr(), expr(), gap(), expr()
+                        else if (r == 5) printf "%s[%s%s]%s=%sReadInteger();", name(), gap(), number(), gap(), gap()
+                        else printf "return%s;", gap()
+                        printf "%s", gap()
+                        if (pick(4) == 0) printf "\n"
+                }
+                print "}"
+        }'
+}
+
+# Runs the command ${@} with its output thrown away and prints how many
+# seconds it took and its peak resident memory in MB: the high-water
+# mark the kernel keeps in /proc/<pid>/status, read every few ms while
+# the command runs (so a run much shorter than that may show less).
+# Any build of dcc can be measured this way, with or without
+# --phase-stats.
+measure()
+{
+        local start=`date +%s%N`
+        "${@}" > /dev/null 2>&1 &
+        local pid=$!
+        echo 0 > /tmp/peak.$$
+        while [ -e /proc/${pid} ]
+        do
+                awk '$1 == "VmHWM:" { print $2 > "/tmp/peak.'$$'" }' /proc/${pid}/status 2> /dev/null
+                sleep 0.002
+        done &
+        local poller=$!
+        wait ${pid}
+        local end=`date +%s%N`
+        wait ${poller}
+        echo "${start} ${end} `cat /tmp/peak.$$`" | awk '{ printf "%.3f %.1f\n", ($2 - $1) / 1e9, $3 / 1024 }'
+        rm -f /tmp/peak.$$
+}
+
+# Prints what measure() does for the fastest of three runs of ${@}.
+measure_best()
+{
+        for run in 1 2 3
+        do
+                measure "${@}"
+        done | sort -n | head -1
+}
+
+# Prints the fewest milliseconds that the phase ${1} took in three runs
+# of ${@:2} with --phase-stats.
+best_phase()
+{
+        local phase=${1}
+        shift
+        for run in 1 2 3
+        do
+                "${@}" --phase-stats 2>&1 > /dev/null | awk -v phase=${phase} '$1 == phase { print $2 }'
+        done | sort -n | head -1
+}
+
+# ./tester.sh --scanners checks that the flex and hand-written scanners
+# produce the same token stream (tokens, values and locations) and the
+# same output for every sample, and for programs made by
+# generate_program(). Flex is run both on the text in place and, with
+# --bounded-memory, on copies it reads a chunk at a time, and each
+# input is given as a named file (mapped), on stdin redirected from the
+# file, and through a pipe (read into memory).
+if [ "${1}" == "--scanners" ]
+then
+        FAILED=""
+        for seed in `seq 1 20`
+        do
+                generate_program ${seed} 300 > /tmp/generated.${seed}.$$.decaf
+        done
+        for input in `ls samples/*.decaf /tmp/generated.*.$$.decaf`
+        do
+                echo -ne "Comparing scanners on ${input}..."
+                ./dcc --scanner=hand ${input} -d tokens > /tmp/hand.$$ 2>&1
+                RESULT="PASS"
+                for flags in "" "--bounded-memory"
+                do
+                        ./dcc --scanner=flex ${flags} ${input} -d tokens 2>&1 \
+                                | diff -aq /tmp/hand.$$ - > /dev/null || RESULT="FAIL"
+                        ./dcc --scanner=flex ${flags} -d tokens < ${input} 2>&1 \
+                                | diff -aq /tmp/hand.$$ - > /dev/null || RESULT="FAIL"
+                        cat ${input} | ./dcc --scanner=flex ${flags} -d tokens 2>&1 \
+                                | diff -aq /tmp/hand.$$ - > /dev/null || RESULT="FAIL"
+                done
+                echo ${RESULT}
+                [ ${RESULT} == "PASS" ] || FAILED="${FAILED} ${input}"
+        done
+        rm -f /tmp/hand.$$ /tmp/generated.*.$$.decaf
+        echo
+        echo "Failures:${FAILED}"
+        exit 0
+fi
+
+# ./tester.sh --scanner-speed times each scanner built into dcc on a
+# generated program of about 30 MB, and prints how many MB a second it
+# scans and parses (the parse phase of --phase-stats), the best of
+# three runs. Its identifiers are all short enough, so the time is not
+# spent reporting errors.
+if [ "${1}" == "--scanner-speed" ]
+then
+        generate_program 1 200000 31 > /tmp/speed.$$.decaf
+        SIZE=`stat -c %s /tmp/speed.$$.decaf`
+        for scanner in hand flex
+        do
+                BEST=""
+                for run in 1 2 3
+                do
+                        MS=`./dcc --scanner=${scanner} --phase-stats /tmp/speed.$$.decaf 2>&1 \
+                                | awk '$1 == "parse" { print $2 }'`
+                        [ -z "${MS}" ] && break
+                        BEST=`echo "${BEST:-${MS}} ${MS}" | awk '{ print $2 < $1 ? $2 : $1 }'`
+                done
+                if [ -z "${BEST}" ]
+                then
+                        echo "${scanner}: not built into dcc"
+                else
+                        echo "${SIZE} ${BEST}" | awk -v scanner=${scanner} \
+                                '{ printf "%s: %.1f MB/s (%.1f MB in %.1f ms)\n", scanner, $1 / 1048576 / ($2 / 1000), $1 / 1048576, $2 }'
+                fi
+        done
+        rm -f /tmp/speed.$$.decaf
+        exit 0
+fi
+
+# ./tester.sh --ast-image checks that saving every sample's tree as an
+# AST image and loading it back prints the same tree, and that the
+# loaded tree saves to the same image. A sample that does not parse
+# has no tree to save. It then damages a byte at a time at sixteen
+# places through each image, and dcc must refuse or load the result
+# without crashing.
+if [ "${1}" == "--ast-image" ]
+then
+        FAILED=""
+        for input in `ls samples/*.decaf`
+        do
+                echo -ne "Round-tripping ${input}..."
+                rm -f /tmp/image.$$
+                ./dcc --dump-ast --emit-ast=/tmp/image.$$ ${input} > /tmp/parsed.$$ 2>/dev/null
+                if [ ! -e /tmp/image.$$ ] && [ ! -s /tmp/parsed.$$ ]
+                then
+                        echo "PASS (no tree)"
+                        continue
+                fi
+                RESULT="PASS"
+                ./dcc --load-ast=/tmp/image.$$ --dump-ast --emit-ast=/tmp/again.$$ 2>/dev/null \
+                        | diff -aq /tmp/parsed.$$ - > /dev/null \
+                        && cmp -s /tmp/image.$$ /tmp/again.$$ || RESULT="FAIL"
+                SIZE=`stat -c %s /tmp/image.$$`
+                for offset in `seq 0 $(( SIZE / 16 + 1 )) $(( SIZE - 1 ))`
+                do
+                        cp /tmp/image.$$ /tmp/damaged.$$
+                        printf '\377' | dd of=/tmp/damaged.$$ bs=1 seek=${offset} \
+                                conv=notrunc 2>/dev/null
+                        ./dcc --load-ast=/tmp/damaged.$$ --dump-ast > /dev/null 2>&1
+                        STATUS=$?  # 255 after errors; 128 + n when killed by signal n
+                        [ ${STATUS} -lt 128 ] || [ ${STATUS} -eq 255 ] || RESULT="FAIL"
+                done
+                echo ${RESULT}
+                [ ${RESULT} == "PASS" ] || FAILED="${FAILED} ${input}"
+        done
+        rm -f /tmp/image.$$ /tmp/again.$$ /tmp/parsed.$$ /tmp/damaged.$$
+        echo
+        echo "Failures:${FAILED}"
+        exit 0
+fi
+
+# ./tester.sh --stress generates programs far larger and deeper than
+# the samples: a body of a million statements, and calls, field
+# accesses, parentheses, blocks and ifs nested a hundred thousand
+# deep. dcc has to check each one without errors on a 1 MB stack and
+# within the time limit, so recursion on the C stack and work that
+# grows with the square of the size both fail it.
+if [ "${1}" == "--stress" ]
+then
+        LIMIT=60 # seconds for each program
+        DEPTH=100000
+        FAILED=""
+        for shape in statements calls fields parentheses blocks ifs
+        do
+                echo -ne "Stress testing ${shape}..."
+                awk -v shape=${shape} -v depth=${DEPTH} 'BEGIN {
+                        if (shape == "statements") {
+                                print "void main() { int x; x = 0;"
+                                for (i = 0; i < 1000000; i++) print "  x = x + 1;"
+                                print "  Print(x); }"
+                        } else if (shape == "calls") {
+                                print "int f(int x) { return x; }"
+                                printf "void main() { int a; a = "
+                                for (i = 0; i < depth; i++) printf "f("
+                                printf "1"
+                                for (i = 0; i < depth; i++) printf ")"
+                                print "; }"
+                        } else if (shape == "fields") {
+                                printf "class A { A n; int v; void g() { int z; z = this"
+                                for (i = 0; i < depth; i++) printf ".n"
+                                print ".v; } }"
+                                print "void main() { }"
+                        } else if (shape == "parentheses") {
+                                printf "void main() { int a; a = "
+                                for (i = 0; i < depth; i++) printf "("
+                                printf "1"
+                                for (i = 0; i < depth; i++) printf ")"
+                                print "; }"
+                        } else if (shape == "blocks") {
+                                printf "void main() { int a; "
+                                for (i = 0; i < depth; i++) printf "{ "
+                                printf "a = 1; "
+                                for (i = 0; i < depth; i++) printf "} "
+                                print "}"
+                        } else if (shape == "ifs") {
+                                printf "void main() { int a; "
+                                for (i = 0; i < depth; i++) printf "if (true) "
+                                print "a = 1; }"
+                        }
+                }' > /tmp/stress.$$
+                RESULT="PASS"
+                ( ulimit -s 1024; timeout ${LIMIT} ./dcc /tmp/stress.$$ ) \
+                        > /tmp/output.$$ 2>&1 || RESULT="FAIL"
+                [ -s /tmp/output.$$ ] && RESULT="FAIL"
+                echo ${RESULT}
+                [ ${RESULT} == "PASS" ] || FAILED="${FAILED} ${shape}"
+        done
+        rm -f /tmp/stress.$$ /tmp/output.$$
+        echo
+        echo "Failures:${FAILED}"
+        exit 0
+fi
+
+# ./tester.sh --line-table [OLD_DCC] measures what scanning a large
+# input costs now that the scanner only notes where each line starts,
+# and the text of a line is cut out when an error quotes it. There are
+# two inputs: 28 MB of a generated program made into comments, which is
+# all scanning and no tree, and 12 MB of a program of a million short
+# statements. Each is run through ./dcc and, if given, OLD_DCC: a dcc
+# built from before the line table, whose scanner lexed each line twice
+# and kept a copy of it.
+if [ "${1}" == "--line-table" ]
+then
+        generate_program 1 200000 31 | awk '{ print "// " $0 }
+                END { print "void main() { }" }' > /tmp/comments.$$.decaf
+        awk 'BEGIN {
+                print "void main() { int x; x = 0;"
+                for (i = 0; i < 1000000; i++) print "  x = x + 1;"
+                print "  Print(x); }"
+        }' > /tmp/statements.$$.decaf
+        printf "%-24s %-10s %6s %9s %8s %8s\n" dcc input MB lines seconds "peak MB"
+        for dcc in ./dcc ${2}
+        do
+                for input in comments statements
+                do
+                        FILE=/tmp/${input}.$$.decaf
+                        printf "%-24s %-10s %6.1f %9d %8.3f %8.1f\n" ${dcc} ${input} \
+                                `stat -c %s ${FILE} | awk '{ print $1 / 1048576 }'` \
+                                `wc -l < ${FILE}` `measure_best ${dcc} ${FILE}`
+                done
+        done
+        rm -f /tmp/comments.$$.decaf /tmp/statements.$$.decaf
+        exit 0
+fi
+
+# ./tester.sh --token-cache compares lexing a program of about 10 MB
+# cold, with each scanner, against replaying its tokens from a token
+# cache. It prints the milliseconds in the parse phase, the best of
+# three runs, and each run's peak memory. The program declares its
+# variables, so checking it is quick and reports nothing.
+if [ "${1}" == "--token-cache" ]
+then
+        awk 'BEGIN {
+                srand(1)
+                print "void main() { int a; int b; double d; bool f; string s;"
+                for (i = 0; i < 150000; i++) {
+                        r = int(rand() * 5)
+                        if (r == 0) print "  a = (b + 12) * a - b / 7 % 0x1F;"
+                        else if (r == 1) print "  d = d * 1.5E3 + 0.25 - d / 4.0;"
+                        else if (r == 2) print "  f = a < b && !f || a == 10;"
+                        else if (r == 3) print "  Print(\"a is \", a, \" and d is \", d);"
+                        else print "  if (f) { s = ReadLine(); } else { b = b + 1; }"
+                }
+                print "}"
+        }' > /tmp/tokens.$$.decaf
+        printf "%-8s %-8s %9s %8s\n" scanner lexing "parse ms" "peak MB"
+        for scanner in hand flex
+        do
+                COLD=`best_phase parse ./dcc --scanner=${scanner} /tmp/tokens.$$.decaf`
+                if [ -z "${COLD}" ]
+                then
+                        echo "${scanner}: not built into dcc"
+                        continue
+                fi
+                rm -f /tmp/cache.$$
+                ./dcc --scanner=${scanner} --token-cache=/tmp/cache.$$ /tmp/tokens.$$.decaf
+                printf "%-8s %-8s %9.1f %8.1f\n" ${scanner} cold ${COLD} \
+                        `measure ./dcc --scanner=${scanner} /tmp/tokens.$$.decaf | cut -d' ' -f2`
+                printf "%-8s %-8s %9.1f %8.1f\n" ${scanner} replay \
+                        `best_phase parse ./dcc --token-cache=/tmp/cache.$$ /tmp/tokens.$$.decaf` \
+                        `measure ./dcc --token-cache=/tmp/cache.$$ /tmp/tokens.$$.decaf | cut -d' ' -f2`
+        done
+        rm -f /tmp/tokens.$$.decaf /tmp/cache.$$
+        exit 0
+fi
+
+# ./tester.sh --list-memory [OLD_DCC] measures the memory taken by
+# programs made of many small methods, which is mostly small lists:
+# formals, actuals, one-statement bodies and implements lists. Each
+# program has classes of twenty methods, from 10,000 methods up to
+# 100,000, and for each it prints what the parse phase allocated and
+# dcc's peak memory. It does the same for OLD_DCC if given: a dcc built
+# from before lists kept their first elements inline, say. A build
+# without --phase-stats shows only its peak.
+if [ "${1}" == "--list-memory" ]
+then
+        printf "%-24s %8s %6s %9s %8s\n" dcc methods MB "parse MB" "peak MB"
+        for classes in 500 2500 5000
+        do
+                awk -v classes=${classes} 'BEGIN {
+                        print "interface Shape { int m0(int a); }"
+                        for (c = 0; c < classes; c++) {
+                                printf "class C%d implements Shape {\n  int v;\n", c
+                                print "  int m0(int a) { return a + v; }"
+                                for (m = 1; m < 20; m++) {
+                                        r = m % 4
+                                        if (r == 0) printf "  int m%d(int a, int b) { if (a < b) return a; return b; }\n", m
+                                        else if (r == 1) printf "  void m%d() { Print(v, \" \"); }\n", m
+                                        else if (r == 2) printf "  bool m%d(int a, double d, bool f) { v = a; return f && m0(a) > 0; }\n", m
+                                        else printf "  int m%d(int a) { return m0(a) * 2; }\n", m
+                                }
+                                print "}"
+                        }
+                        print "void main() { C0 c; c = New(C0); Print(c.m0(1)); }"
+                }' > /tmp/methods.$$.decaf
+                for dcc in ./dcc ${2}
+                do
+                        PARSE=`${dcc} --phase-stats /tmp/methods.$$.decaf 2>&1 > /dev/null \
+                                | awk '$1 == "parse" { printf "%.1f", $4 / 1048576 }'`
+                        printf "%-24s %8d %6.1f %9s %8.1f\n" ${dcc} $(( classes * 20 )) \
+                                `stat -c %s /tmp/methods.$$.decaf | awk '{ print $1 / 1048576 }'` \
+                                ${PARSE:--} `measure ${dcc} /tmp/methods.$$.decaf | cut -d' ' -f2`
+                done
+        done
+        rm -f /tmp/methods.$$.decaf
+        exit 0
+fi
+
+# ./tester.sh --scopes [OLD_DCC] times programs whose names are looked
+# up in big scopes: thousands of globals, each used from main(), and
+# twenty classes of hundreds of members, whose methods use the fields.
+# It prints the seconds dcc took, the best of three runs, and its peak
+# memory, for ./dcc and, if given, OLD_DCC: say a dcc built from before
+# scopes had hash tables, which searched each scope from the start.
+if [ "${1}" == "--scopes" ]
+then
+        printf "%-24s %-8s %7s %8s %8s\n" dcc shape names seconds "peak MB"
+        for shape in globals members
+        do
+                for names in 2000 10000 50000
+                do
+                        awk -v shape=${shape} -v names=${names} 'BEGIN {
+                                srand(1)
+                                if (shape == "globals") {
+                                        for (i = 0; i < names; i++) printf "int g%d;\n", i
+                                        print "void main() {"
+                                        for (i = 0; i < names; i++)
+                                                printf "  g%d = g%d + 1;\n", i, int(rand() * names)
+                                        print "}"
+                                } else {
+                                        # Half of each class is fields, half methods.
+                                        members = names / 20 / 2
+                                        for (c = 0; c < 20; c++) {
+                                                printf "class C%d {\n", c
+                                                for (i = 0; i < members; i++) printf "  int f%d;\n", i
+                                                for (i = 0; i < members; i++)
+                                                        printf "  int m%d() { return f%d + f%d; }\n", i,
+                                                                int(rand() * members), int(rand() * members)
+                                                print "}"
+                                        }
+                                        print "void main() { }"
+                                }
+                        }' > /tmp/scopes.$$.decaf
+                        for dcc in ./dcc ${2}
+                        do
+                                printf "%-24s %-8s %7d %8.3f %8.1f\n" ${dcc} ${shape} ${names} \
+                                        `measure_best ${dcc} /tmp/scopes.$$.decaf`
+                        done
+                done
+        done
+        rm -f /tmp/scopes.$$.decaf
+        exit 0
+fi
+
+# ./tester.sh --subtypes [OLD_DCC] times the subtype checks of deep
+# class hierarchies: a chain of 100 or 1,000 classes, each extending the
+# one before, with 50 classes at the bottom that each implement 24 of 48
+# interfaces, and a main() of 60,000 assignments from the bottom classes
+# to classes up the chain and to the interfaces they implement. It
+# prints the milliseconds of the check phase, the best of three runs,
+# for ./dcc and, if given, OLD_DCC: say a dcc built from before classes
+# were numbered, which walked the chain by name for every assignment.
+if [ "${1}" == "--subtypes" ]
+then
+        printf "%-24s %6s %10s %9s
+" dcc depth interfaces "check ms"
+        for depth in 100 1000
+        do
+                awk -v depth=${depth} 'BEGIN {
+                        srand(1)
+                        for (i = 0; i < 48; i++) printf "interface I%d { int m%d(); }\n", i, i
+                        print "class C0 { int v; }"
+                        for (i = 1; i < depth; i++) printf "class C%d extends C%d { }\n", i, i - 1
+                        for (j = 0; j < 50; j++) {
+                                printf "class L%d extends C%d implements I%d", j, depth - 1, j % 48
+                                n = 1
+                                for (i = 0; i < 48 && n < 24; i++)
+                                        if (i != j % 48 && rand() < 0.5) {
+                                                printf ", I%d", i
+                                                impl[j, n++] = i
+                                        }
+                                impl[j, 0] = j % 48
+                                count[j] = n
+                                printf " {\n"
+                                for (k = 0; k < n; k++) printf "  int m%d() { return %d; }\n", impl[j, k], k
+                                print "}"
+                        }
+                        print "void main() {"
+                        for (j = 0; j < 50; j++) printf "  L%d l%d;\n", j, j
+                        for (i = 0; i < depth; i++) printf "  C%d c%d;\n", i, i
+                        for (i = 0; i < 48; i++) printf "  I%d i%d;\n", i, i
+                        for (a = 0; a < 30000; a++) {
+                                j = int(rand() * 50)
+                                printf "  c%d = l%d;\n", int(rand() * depth), j
+                                printf "  i%d = l%d;\n", impl[j, int(rand() * count[j])], j
+                        }
+                        print "}"
+                }' > /tmp/subtypes.$$.decaf
+                for dcc in ./dcc ${2}
+                do
+                        printf "%-24s %6d %10d %9s\n" ${dcc} ${depth} 48 \
+                                `best_phase check ${dcc} /tmp/subtypes.$$.decaf`
+                done
+        done
+        rm -f /tmp/subtypes.$$.decaf
+        exit 0
+fi
+
+# ./tester.sh --overrides [OLD_DCC] times the signature checks of
+# methods with array-typed formals: a chain of 50 classes, each of
+# which overrides 100 or 400 methods taking (int[][], C0[], string[][][])
+# and implements an interface that declares them all, so that every
+# method is checked against the one it overrides and the one in the
+# interface. It prints the milliseconds of the parse and check phases,
+# the best of three runs, for ./dcc and, if given, OLD_DCC: say a dcc
+# built from before functions had interned signatures, which spelled
+# out each array type's name again for every comparison.
+if [ "${1}" == "--overrides" ]
+then
+        printf "%-24s %8s %9s %9s\n" dcc methods "parse ms" "check ms"
+        for methods in 100 400
+        do
+                awk -v methods=${methods} 'BEGIN {
+                        formals = "(int[][] a, C0[] b, string[][][] c)"
+                        print "interface Shape {"
+                        for (m = 0; m < methods; m++) printf "  int[] m%d%s;\n", m, formals
+                        print "}"
+                        for (c = 0; c < 50; c++) {
+                                if (c == 0) printf "class C0 implements Shape {\n"
+                                else printf "class C%d extends C%d implements Shape {\n", c, c - 1
+                                for (m = 0; m < methods; m++)
+                                        printf "  int[] m%d%s { return a[%d]; }\n", m, formals, c
+                                print "}"
+                        }
+                        print "void main() { C49 c; Shape s; c = New(C49); s = c; }"
+                }' > /tmp/overrides.$$.decaf
+                for dcc in ./dcc ${2}
+                do
+                        printf "%-24s %8d %9s %9s\n" ${dcc} $(( methods * 50 )) \
+                                `best_phase parse ${dcc} /tmp/overrides.$$.decaf` \
+                                `best_phase check ${dcc} /tmp/overrides.$$.decaf`
+                done
+        done
+        rm -f /tmp/overrides.$$.decaf
+        exit 0
+fi
+
 if [ ! -z ${1} ]
 then
         input="samples/${1}.decaf"
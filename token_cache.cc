@@ -0,0 +1,263 @@
+/* File: token_cache.cc
+ * --------------------
+ * Implementation of the token cache. The file is a small header
+ *
+ *     magic, format version, text length, text hash, body hash
+ *
+ * followed by the body, one record per token:
+ *
+ *     code      one byte (bison's codes start at 258, so those are
+ *               stored less 128; single characters are below 128)
+ *     position  how many lines on from the previous token in the low
+ *               two bits (3 means a further number follows), and above
+ *               them the column, counted from the end of the previous
+ *               token when on the same line
+ *     length    last_column - first_column
+ *     gap       how many characters of text lie between the previous
+ *               token and this one (the offsets cannot be worked out
+ *               from the columns, since a tab takes up several)
+ *     value     for constants and identifiers
+ *
+ * Numbers are variable-length (7 bits per byte), so most tokens take
+ * three bytes. Each identifier's characters are stored only the first
+ * time it appears; after that it is referred to by its position in
+ * that order.
+ */
+
+#include "token_cache.h"
+#include "scanner.h"
+#include "utility.h" // for PrintDebug(), HashBytes()
+#include "errors.h"
+#include "parser.h"  // for token codes, YYSTYPE
+#include "source.h"
+#include "intern.h"  // for Intern()
+#include "arena.h"   // for ArenaStrndup()
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+
+static const char Magic[8] = "dcctok\n";
+static const uint32_t FormatVersion = 2; // bump if the token codes or records change
+
+
+/* Recording
+ * ---------
+ */
+void TokenCache::PutNumber(uint64_t n)
+{
+    while (n >= 0x80) {
+        body += (char)(n | 0x80);
+        n >>= 7;
+    }
+    body += (char)n;
+}
+
+void TokenCache::PutSigned(int64_t n)
+{
+    PutNumber(((uint64_t)n << 1) ^ (uint64_t)(n >> 63)); // zigzag
+}
+
+void TokenCache::PutString(const char *s, size_t len)
+{
+    PutNumber(len);
+    body.append(s, len);
+}
+
+void TokenCache::StartRecording(const char *path, SourceText *source)
+{
+    recordPath = path;
+    body.clear();
+    nameIndex.clear();
+    prevLine = prevEnd = 0;
+    prevEndOffset = 0;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = FormatVersion;
+    header.unused = 0;
+    header.textLength = source->Length();
+    header.textHash = HashBytes(source->Text(), source->Length());
+}
+
+/* Writes the cache to a temporary file and renames it into place, so a
+ * run that reads it at the same time sees either the old file or the
+ * whole new one.
+ */
+void TokenCache::Write()
+{
+    header.bodyHash = HashBytes(body.data(), body.size());
+    std::string temp = std::string(recordPath) + ".tmp" + std::to_string(getpid());
+    FILE *fp = fopen(temp.c_str(), "wb");
+    bool ok = fp && fwrite(&header, sizeof(header), 1, fp) == 1 &&
+              fwrite(body.data(), 1, body.size(), fp) == body.size();
+    if (fp && fclose(fp) != 0)
+        ok = false;
+    if (ok && rename(temp.c_str(), recordPath) == 0)
+        PrintDebug("lex", "Wrote token cache %s (%lu bytes)", recordPath,
+                   (unsigned long)(sizeof(header) + body.size()));
+    else {
+        unlink(temp.c_str());
+        PrintDebug("lex", "Could not write token cache %s", recordPath);
+    }
+}
+
+void TokenCache::Record(int token, const YYSTYPE *lval, const yyltype *lloc)
+{
+    Assert(token < 128 || (token >= 256 && token < 384));
+    body += (char)(token < 256 ? token : token - 128);
+
+    int lines = lloc->first_line - prevLine;
+    int column = lines ? lloc->first_column : lloc->first_column - prevEnd;
+    if (lines >= 0 && lines < 3)
+        PutNumber(((uint64_t)column << 2) | lines);
+    else {
+        PutNumber(((uint64_t)column << 2) | 3);
+        PutSigned(lines);
+    }
+    PutNumber(lloc->last_column - lloc->first_column);
+    PutSigned((int64_t)lloc->first_offset - prevEndOffset);
+    prevLine = lloc->first_line;
+    prevEnd = lloc->last_column;
+    prevEndOffset = (int64_t)lloc->last_offset + 1;
+
+    switch (token) {
+      case T_IntConstant:    PutSigned(lval->integerConstant); break;
+      case T_BoolConstant:   PutNumber(lval->boolConstant); break;
+      case T_DoubleConstant: body.append((const char *)&lval->doubleConstant, sizeof(double)); break;
+      case T_StringConstant: PutString(lval->stringConstant, strlen(lval->stringConstant)); break;
+      case T_Identifier: {
+        std::unordered_map<const char *, unsigned>::iterator it = nameIndex.find(lval->identifier);
+        if (it != nameIndex.end())
+            PutNumber(it->second);
+        else { // first appearance: its number is the next one, then its characters
+            unsigned n = nameIndex.size();
+            nameIndex[lval->identifier] = n;
+            PutNumber(n);
+            PutString(lval->identifier, strlen(lval->identifier));
+        }
+        break;
+      }
+    }
+
+    if (token == 0) {
+        if (ReportError::NumErrors() == 0)
+            Write();
+        body.clear();
+        nameIndex.clear();
+    }
+}
+
+
+/* Replaying
+ * ---------
+ * The body hash was checked when the file was loaded, so the records
+ * are known to be what we wrote; running off the end is still treated
+ * as end of file rather than trusted.
+ */
+uint64_t TokenCache::GetNumber()
+{
+    uint64_t n = 0;
+    for (int shift = 0; pos < cache.size() && shift < 64; shift += 7) {
+        unsigned char b = cache[pos++];
+        n |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return n;
+}
+
+int64_t TokenCache::GetSigned()
+{
+    uint64_t n = GetNumber();
+    return (int64_t)(n >> 1) ^ -(int64_t)(n & 1);
+}
+
+const char *TokenCache::GetString(size_t *len)
+{
+    *len = GetNumber();
+    if (*len > cache.size() - pos)
+        *len = cache.size() - pos;
+    const char *s = cache.data() + pos;
+    pos += *len;
+    return s;
+}
+
+bool TokenCache::Load(const char *path, SourceText *source)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+    Header h;
+    bool ok = fread(&h, sizeof(h), 1, fp) == 1 &&
+              memcmp(h.magic, Magic, sizeof(Magic)) == 0 &&
+              h.version == FormatVersion && h.textLength == source->Length() &&
+              h.textHash == HashBytes(source->Text(), source->Length());
+    cache.clear();
+    char buf[64 * 1024];
+    size_t n;
+    while (ok && (n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        cache.append(buf, n);
+    fclose(fp);
+    if (!ok || h.bodyHash != HashBytes(cache.data(), cache.size())) {
+        cache.clear();
+        return false;
+    }
+
+    pos = 0;
+    names.clear();
+    prevLine = prevEnd = 0;
+    prevEndOffset = 0;
+    this->source = source;
+    source->DeferLineStarts(); // no scanner will be telling us where lines start
+    PrintDebug("lex", "Replaying token cache %s", path);
+    return true;
+}
+
+int TokenCache::Replay(YYSTYPE *lval, yyltype *lloc)
+{
+    if (pos >= cache.size())
+        return 0;
+    int token = (unsigned char)cache[pos++];
+    if (token >= 128)
+        token += 128;
+
+    uint64_t position = GetNumber();
+    int lines = position & 3;
+    if (lines == 3)
+        lines = GetSigned();
+    lloc->first_line = lloc->last_line = prevLine += lines; // no token spans lines
+    lloc->first_column = (position >> 2) + (lines ? 0 : prevEnd);
+    lloc->last_column = lloc->first_column + GetNumber();
+    prevEnd = lloc->last_column;
+    lloc->first_offset = prevEndOffset + GetSigned();
+    lloc->last_offset = lloc->first_offset + (lloc->last_column - lloc->first_column);
+    prevEndOffset = (int64_t)lloc->last_offset + 1;
+
+    size_t len;
+    const char *s;
+    switch (token) {
+      case T_IntConstant:  lval->integerConstant = GetSigned(); break;
+      case T_BoolConstant: lval->boolConstant = GetNumber(); break;
+      case T_DoubleConstant:
+        if (cache.size() - pos >= sizeof(double))
+            memcpy(&lval->doubleConstant, cache.data() + pos, sizeof(double));
+        pos += sizeof(double);
+        break;
+      case T_StringConstant:
+        s = GetString(&len);
+        lval->stringConstant = ArenaStrndup(s, len);
+        for (size_t i = 0; i < len; i++)
+            if (s[i] == '\t')
+                source->AddLiteralTab(lloc->first_offset + i);
+        break;
+      case T_Identifier: {
+        size_t n = GetNumber();
+        if (n == names.size()) {
+            s = GetString(&len);
+            names.push_back(Intern(s, len));
+        }
+        lval->identifier = n < names.size() ? names[n] : Intern("");
+        break;
+      }
+    }
+    return token;
+}
@@ -0,0 +1,86 @@
+/* File: token_cache.h
+ * -------------------
+ * This file declares the token cache. Given --token-cache=<file>, dcc
+ * saves the token stream it lexed to that file, along with a hash of
+ * the program text. The next time it is run on the same text it finds
+ * the hash matches and hands the parser the saved tokens instead of
+ * running a scanner at all; the line table that error messages use is
+ * then only built if an error actually needs to quote a line.
+ *
+ * Each token is stored with its code, the value the parser would find
+ * in yylval and the yylloc span the scanner gave it. The stream ends
+ * with the end-of-file token, whose location matters too, since it is
+ * what the parser reports for anything missing at the end of the file.
+ * A cache is only written when lexing finished without any errors, so
+ * replaying one never has diagnostics of its own to reproduce.
+ */
+
+#ifndef _H_token_cache
+#define _H_token_cache
+
+#include <stddef.h>   // for size_t
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "location.h"
+
+union YYSTYPE;
+class SourceText;
+
+class TokenCache
+{
+  public:
+    // Reads the cache file at path and returns true if it holds the
+    // tokens for exactly this text, in which case they are ready for
+    // Replay(). Returns false if the file does not exist, is from an
+    // older dcc or another program, or is damaged.
+    bool Load(const char *path, SourceText *source);
+
+    // Fills in *lval and *lloc for the next saved token and returns its
+    // code, just as a scanner would.
+    int Replay(YYSTYPE *lval, yyltype *lloc);
+
+    // Starts saving the tokens lexed from this text. Each one is passed
+    // to Record(), and when the end-of-file token arrives the cache is
+    // written to path, unless errors have been reported by then.
+    void StartRecording(const char *path, SourceText *source);
+
+    // Saves token along with its value and location.
+    void Record(int token, const YYSTYPE *lval, const yyltype *lloc);
+
+  private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t unused;
+        uint64_t textLength;
+        uint64_t textHash;
+        uint64_t bodyHash;
+    };
+
+    void PutNumber(uint64_t n);
+    void PutSigned(int64_t n);
+    void PutString(const char *s, size_t len);
+    void Write();
+    uint64_t GetNumber();
+    int64_t GetSigned();
+    const char *GetString(size_t *len);
+
+    int prevLine, prevEnd;                // where the previous token was
+    int64_t prevEndOffset;                // and the offset just past it
+
+    // Recording
+    const char *recordPath;
+    Header header;
+    std::string body;
+    std::unordered_map<const char *, unsigned> nameIndex; // interned name -> number
+
+    // Replaying
+    std::string cache;
+    size_t pos;
+    std::vector<const char *> names;
+    SourceText *source;                   // told about tabs in strings
+};
+
+#endif
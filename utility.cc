@@ -10,6 +10,7 @@
 #include "list.h"
 
 static List<const char*> debugKeys;
+static List<const char*> options; // "name=value" or "name", minus the --
 static const int BufferSize = 2048;
 
 void Failure(const char *format, ...)
@@ -66,17 +67,56 @@ void PrintDebug(const char *key, const char *format, ...)
 }
 
 
-void ParseCommandLine(int argc, char *argv[])
+const char *GetOption(const char *name)
 {
-  if (argc == 1)
+  int len = strlen(name);
+  for (int i = 0; i < options.NumElements(); i++) {
+    const char *opt = options.Nth(i);
+    if (strncmp(opt, name, len) == 0 && (opt[len] == '=' || opt[len] == '\0'))
+      return opt[len] ? opt + len + 1 : opt + len;
+  }
+  return NULL;
+}
+
+
+void ParseCommandLine(int argc, char *argv[], List<const char*> *paths)
+{
+  int i;
+
+  for (i = 1; i < argc && strcmp(argv[i], "-d") != 0; i++) {
+    if (strncmp(argv[i], "--", 2) == 0)
+      options.Append(argv[i] + 2);
+    else if (argv[i][0] != '-') // non-flags are source files
+      paths->Append(argv[i]);
+    else
+      break;
+  }
+
+  if (i == argc)
     return;
   
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
+  if (strcmp(argv[i], "-d") != 0) { // next arg is not -d
+    printf("Usage:   [--option=value ...] [<file.decaf> ...] [-d <debug-key-1> <debug-key-2> ...] \n");
     exit(2);
   }
 
-  for (int i = 2; i < argc; i++)
+  for (i++; i < argc; i++)
     SetDebugForKey(argv[i], true);
 }
 
+uint64_t HashBytes(const char *p, size_t len)
+{
+    const uint64_t mul = 0xff51afd7ed558ccdULL;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * mul;
+        h ^= h >> 32;
+    }
+    uint64_t w = 0;
+    memcpy(&w, p + i, len - i);
+    h = (h ^ w) * mul;
+    return h ^ (h >> 29);
+}
@@ -9,6 +9,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 
 
 /* Function: Failure()
@@ -72,12 +73,36 @@ bool IsDebugOn(const char *key);
 
 
 
+/* Function: GetOption()
+ * Usage: const char *which = GetOption("scanner");
+ * -----------------------------------------------
+ * Returns the value given for --name=value on the command line, "" if
+ * it was given as just --name, or NULL if it was not given at all.
+ */
+const char *GetOption(const char *name);
+
+
+
 /* Function: ParseCommandLine
  * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+ * Turn on the debugging flags from the command line.  Options of the
+ * form --name=value and source file paths may come first; after that,
+ * verifies that the next argument is -d, and then interpret all the
+ * arguments that follow as being flags to turn on. The source paths are
+ * appended to paths; if there are none, the source is read from stdin.
+ */
+template <class Element, int InlineCapacity = 0> class List; // see list.h
+void ParseCommandLine(int argc, char *argv[], List<const char*> *paths);
+
+
+
+/* Function: HashBytes()
+ * Usage: if (h.bodyHash != HashBytes(body, length)) ...
+ * -----------------------------------------------------
+ * A quick 64-bit hash of len bytes, eight at a time. It only has to
+ * notice that a saved file has been edited or damaged, not stand up to
+ * someone attacking it.
  */
-void ParseCommandLine(int argc, char *argv[]);
+uint64_t HashBytes(const char *p, size_t len);
      
 #endif
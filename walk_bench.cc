@@ -0,0 +1,92 @@
+/* File: walk_bench.cc
+ * -------------------
+ * A program of its own (make walk_bench) that times the visitors the
+ * annotate phase runs, each in a walk of its own against all of them in
+ * one WalkFused() (see ast_visitor.h). It parses the file named on the
+ * command line (by default samples/matrix.decaf) as many times as asked
+ * (by default 2000), and walks every tree: with AssignLevels, then
+ * FindContexts, then CountNodes, and with the three fused. It prints
+ * the milliseconds for each way, the best of twenty runs.
+ *
+ * BuildScopes and BindNames are left out: they make new scopes each
+ * time they run, so repeating them would time the allocator too.
+ *
+ *     ./walk_bench [file [copies]]
+ */
+
+#include "compilation.h"
+#include "parser.h"   // for InitParser()
+#include "ast_passes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+template <class F> static double BestMilliseconds(F run)
+{
+    double best = 1e30;
+    for (int i = 0; i < 20; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double, std::milli> taken = std::chrono::steady_clock::now() - start;
+        best = std::min(best, taken.count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "samples/matrix.decaf";
+    int copies = argc > 2 ? atoi(argv[2]) : 2000;
+
+    InitParser();
+    std::vector<Compilation *> comps;
+    std::vector<Program *> programs;
+    for (int i = 0; i < copies; i++) {
+        Compilation *comp = new Compilation(path);
+        if (!comp->Load()) {
+            fprintf(stderr, "Cannot open source file '%s'\n", path);
+            return 2;
+        }
+        Program *program = comp->Parse();
+        if (!program) {
+            fprintf(stderr, "%s does not parse\n", path);
+            return 2;
+        }
+        programs.push_back(program);
+        comps.push_back(comp); // the tree lives as long as it does
+    }
+
+    TreeStats stats = TreeStats();
+    for (Program *program : programs)
+        CountNodes(&stats).Walk(program);
+
+    double separate = BestMilliseconds([&] {
+        for (Program *program : programs) {
+            AssignLevels levels;
+            FindContexts contexts;
+            TreeStats counted = TreeStats();
+            CountNodes counts(&counted);
+            levels.Walk(program);
+            contexts.Walk(program);
+            counts.Walk(program);
+        }
+    });
+    double fused = BestMilliseconds([&] {
+        for (Program *program : programs) {
+            AssignLevels levels;
+            FindContexts contexts;
+            TreeStats counted = TreeStats();
+            CountNodes counts(&counted);
+            WalkFused(program, levels, contexts, counts);
+        }
+    });
+
+    printf("%d copies of %s: %d nodes\n", copies, path, stats.nodes);
+    printf("%-10s %10s\n", "walks", "ms");
+    printf("%-10s %10.2f\n", "separate", separate);
+    printf("%-10s %10.2f\n", "fused", fused);
+    return 0;
+}